@@ -0,0 +1,96 @@
+#include <cstdio>
+#include <memory>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "arena.h"
+#include "bench.h"
+#include "pool.h"
+
+namespace {
+    /// Stands in for a Cone, Disk or Cylinder, which own their geometry elsewhere
+    struct Shape {
+        float radius, height;
+        unsigned slices;
+        Shape(float r, float h, unsigned s) : radius(r), height(h), slices(s) {}
+    };
+
+    /// Stands in for a MultiEntity
+    struct Node {
+        std::shared_ptr<Shape> mesh;
+        std::shared_ptr<glm::mat4> transform;
+        Node* next;
+    };
+
+    /// Builds the chain MeshMaker::tree does, keeps the meshes as the EntityStore would and drops the rest
+    template<class MakeShape, class MakeTransform, class MakeNode, class FreeNode>
+    float trees(unsigned count, std::vector< std::shared_ptr<Shape> >& kept,
+                MakeShape shape, MakeTransform transform, MakeNode node, FreeNode release) {
+        float sum = 0.0f;
+        for(unsigned x = 0; x < count; ++x) {
+            const float h = 2.0f + x % 5;
+            auto cone = shape(1.0f, h / 1.5f, 16u);
+            auto cap = shape(1.0f, 0.0f, 16u);
+            auto trunk = shape(0.4f, h / 3.0f, 8u);
+            Node* chain = node(cone, transform(glm::mat4(1.0f)), nullptr);
+            chain = node(cap, transform(glm::mat4(2.0f)), chain);
+            chain = node(trunk, transform(glm::mat4(h)), chain);
+
+            for(Node* i = chain; i != nullptr; i = i->next) {
+                sum += (*i->transform)[0][0];
+                kept.push_back(i->mesh);
+            }
+            while(chain != nullptr) {
+                Node* next = chain->next;
+                release(chain);
+                chain = next;
+            }
+        }
+        return sum;
+    }
+}
+
+/// Compares building tree shaped entity chains from the heap against the pools and an arena
+int Bench::alloc() {
+    const unsigned counts[] = {1000, 100000};
+    printf("%8s %10s %10s %10s %12s %8s\n", "trees", "heap ms", "calls", "pooled ms", "calls", "speedup");
+
+    int result = 0;
+    for(unsigned count : counts) {
+        float heap_sum = 0.0f, pooled_sum = 0.0f;
+        const double heap_ms = best(3, [&]() {
+            std::vector< std::shared_ptr<Shape> > kept;
+            heap_sum = trees(count, kept,
+                [](float r, float h, unsigned s) { return std::make_shared<Shape>(r, h, s); },
+                [](const glm::mat4& m) { return std::make_shared<glm::mat4>(m); },
+                [](std::shared_ptr<Shape> m, std::shared_ptr<glm::mat4> t, Node* n) { return new Node{m, t, n}; },
+                [](Node* n) { delete n; });
+        });
+
+        size_t pooled_calls = 0;
+        const double pooled_ms = best(3, [&]() {
+            const size_t chunks = PoolBase::totals().chunks;
+            Arena arena;
+            std::vector< std::shared_ptr<Shape> > kept;
+            pooled_sum = trees(count, kept,
+                [&arena](float r, float h, unsigned s) { return arena.share<Shape>(r, h, s); },
+                [](const glm::mat4& m) { return pooled<glm::mat4>(m); },
+                [](std::shared_ptr<Shape> m, std::shared_ptr<glm::mat4> t, Node* n) {
+                    return Pool<Node>::global().create(Node{m, t, n});
+                },
+                [](Node* n) { Pool<Node>::global().destroy(n); });
+            pooled_calls = arena.blocksAllocated() + PoolBase::totals().chunks - chunks;
+            kept.clear();
+        });
+
+        // Three shapes, three transforms and three nodes per tree
+        printf("%8u %10.2f %10u %10.2f %12zu %7.1fx\n", count, heap_ms, count * 9, pooled_ms, pooled_calls,
+               heap_ms / pooled_ms);
+
+        if(heap_sum != pooled_sum) {
+            printf("pooled chains differ from the heap ones at %u trees\n", count);
+            result = 1;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <chrono>
+
+namespace Bench {
+
+    /// @return The fastest of runs calls to fn, in milliseconds
+    template<class F>
+    double best(unsigned runs, F fn) {
+        double fastest = 0.0;
+        for(unsigned x = 0; x < runs; ++x) {
+            auto start = std::chrono::steady_clock::now();
+            fn();
+            std::chrono::duration<double, std::milli> took = std::chrono::steady_clock::now() - start;
+            if(x == 0 || took.count() < fastest) fastest = took.count();
+        }
+        return fastest;
+    }
+
+    /// Each returns 0 on success
+    int normalMap();
+    int objLoad();
+    int meshOpt();
+    int sceneLoad();
+    int alloc();
+}
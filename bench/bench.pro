@@ -0,0 +1,26 @@
+# Microbenchmarks, build with: cd bench && qmake && make && ./bench [name]
+CONFIG += release console c++14
+CONFIG -= app_bundle
+TEMPLATE = app
+QT -= gui
+
+OBJECTS_DIR=build
+
+DESTDIR = .
+TARGET=bench
+
+INCLUDEPATH += /usr/include/glm/
+INCLUDEPATH += $$PWD/../include
+SOURCES += $$PWD/*.cpp
+SOURCES += $$PWD/../src/procedural.cpp \
+           $$PWD/../src/heightkernel.cpp \
+           $$PWD/../src/heightkernel_sse2.cpp \
+           $$PWD/../src/heightkernel_avx2.cpp \
+           $$PWD/../src/normalkernel.cpp \
+           $$PWD/../src/threadpool.cpp \
+           $$PWD/../src/fastobj.cpp \
+           $$PWD/../src/mappedfile.cpp \
+           $$PWD/../src/meshopt.cpp \
+           $$PWD/../src/scenefile.cpp \
+           $$PWD/../src/sourcestamp.cpp \
+           $$PWD/../src/arena.cpp
@@ -0,0 +1,30 @@
+#include <cstdio>
+#include <cstring>
+
+#include "bench.h"
+
+int main(int argc, char** argv) {
+    const struct { const char* name; int (*run)(); } benches[] = {
+        {"normalmap", Bench::normalMap},
+        {"objload",   Bench::objLoad},
+        {"meshopt",   Bench::meshOpt},
+        {"sceneload", Bench::sceneLoad},
+        {"alloc",     Bench::alloc}
+    };
+
+    // With no arguments run everything
+    int failed = 0;
+    for(auto&& b : benches) {
+        bool selected = argc < 2;
+        for(int x = 1; x < argc; ++x)
+            if(std::strcmp(argv[x], b.name) == 0) selected = true;
+        if(!selected) continue;
+
+        printf("== %s\n", b.name);
+        if(b.run() != 0) {
+            printf("%s FAILED\n", b.name);
+            ++failed;
+        }
+    }
+    return failed;
+}
@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include "bench.h"
+#include "meshopt.h"
+
+namespace {
+    /// A UV sphere with its triangles shuffled, the worst order for the vertex cache
+    void shuffledSphere(uint32_t slices, std::vector<GLfloat>& points, std::vector<GLuint>& elements) {
+        const uint32_t stacks = slices / 2;
+        for(uint32_t y = 0; y <= stacks; ++y) {
+            const float phi = 3.14159265f * y / stacks;
+            for(uint32_t x = 0; x <= slices; ++x) {
+                const float theta = 6.2831853f * x / slices;
+                points.push_back(std::sin(phi) * std::cos(theta));
+                points.push_back(std::cos(phi));
+                points.push_back(std::sin(phi) * std::sin(theta));
+            }
+        }
+
+        std::vector<GLuint> quads;
+        for(uint32_t y = 0; y < stacks; ++y) {
+            for(uint32_t x = 0; x < slices; ++x) {
+                const GLuint a = y * (slices + 1) + x, b = a + slices + 1;
+                const GLuint tris[6] = { a, b, a + 1, a + 1, b, b + 1 };
+                quads.insert(quads.end(), tris, tris + 6);
+            }
+        }
+
+        std::vector<size_t> order(quads.size() / 3);
+        for(size_t x = 0; x < order.size(); ++x) order[x] = x;
+        std::shuffle(order.begin(), order.end(), std::mt19937(1));
+        for(size_t t : order) elements.insert(elements.end(), quads.begin() + t * 3, quads.begin() + t * 3 + 3);
+    }
+}
+
+/// Reports how much MeshOpt::optimize improves the vertex cache and how long it takes
+int Bench::meshOpt() {
+    const uint32_t sizes[] = {64, 256, 1024};
+    printf("%8s %10s %10s %10s %10s %10s\n", "tris", "verts", "welded", "acmr", "optimized", "ms");
+
+    for(uint32_t size : sizes) {
+        std::vector<GLfloat> points;
+        std::vector<GLuint> elements;
+        shuffledSphere(size, points, elements);
+
+        MeshOpt::Report report;
+        std::vector<GLfloat> p;
+        std::vector<GLuint> e;
+        const double ms = best(3, [&]() {
+            p = points;
+            e = elements;
+            std::vector<MeshOpt::Stream> streams(1);
+            streams[0].data = &p;
+            streams[0].components = 3;
+            report = MeshOpt::optimize(e, streams);
+        });
+
+        printf("%8zu %10u %10u %10.3f %10.3f %10.2f\n", elements.size() / 3, report.vertices_before,
+               report.vertices_after, report.acmr_before, report.acmr_after, ms);
+
+        if(e.size() != elements.size() || report.acmr_after > report.acmr_before) {
+            printf("optimizing made things worse at %u\n", size);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,44 @@
+#include <cstdio>
+#include <cstring>
+#include <memory>
+
+#include "bench.h"
+#include "normalkernel.h"
+#include "procedural.h"
+#include "threadpool.h"
+
+/// Compares generateNormalMap against the scalar kernel it replaced
+int Bench::normalMap() {
+    const uint32_t sizes[] = {256, 1024, 4096};
+    printf("%u threads\n", ThreadPool::global().size());
+    printf("%6s %12s %12s %12s %8s\n", "size", "scalar ms", "sse2 ms", "parallel ms", "speedup");
+
+    for(uint32_t size : sizes) {
+        std::unique_ptr<uint8_t[]> heights(Procedural::generateHeightMap(size, size));
+        std::unique_ptr<uint8_t[]> reference(new uint8_t[size * size * 4]);
+        std::unique_ptr<uint8_t[]> simd(new uint8_t[size * size * 4]);
+        std::unique_ptr<uint8_t[]> parallel;
+
+        const unsigned runs = size < 4096 ? 5 : 1;
+        const double scalar_ms = best(runs, [&]() {
+            for(uint32_t x = 0; x < size; ++x)
+                NormalKernel::rowScalar(size, size, heights.get(), x, reference.get() + x * size * 4);
+        });
+        const double simd_ms = best(runs, [&]() {
+            for(uint32_t x = 0; x < size; ++x)
+                NormalKernel::rowSSE2(size, size, heights.get(), x, simd.get() + x * size * 4);
+        });
+        const double parallel_ms = best(runs, [&]() {
+            parallel.reset(Procedural::generateNormalMap(size, size, heights.get()));
+        });
+
+        printf("%6u %12.2f %12.2f %12.2f %7.1fx\n", size, scalar_ms, simd_ms, parallel_ms, scalar_ms / parallel_ms);
+
+        if(std::memcmp(reference.get(), simd.get(), size * size * 4) != 0 ||
+           std::memcmp(reference.get(), parallel.get(), size * size * 4) != 0) {
+            printf("output differs from the scalar kernel at %u\n", size);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+
+// The reference implementation, FastObj also borrows its material reader
+#define TINYOBJLOADER_IMPLEMENTATION
+#include "tiny_obj_loader.h"
+
+#include "bench.h"
+#include "fastobj.h"
+#include "threadpool.h"
+
+namespace {
+    const char* const OBJ_FILE = "objload_bench.obj";
+    const char* const MTL_FILE = "objload_bench.mtl";
+
+    /**
+     * A size x size grid of quads with normals and texture coordinates, split
+     * into groups and materials every few rows. Every other group uses negative
+     * indices so chunks have to be stitched back together.
+     */
+    void writeGrid(uint32_t size) {
+        std::ofstream mtl(MTL_FILE);
+        for(int x = 0; x < 3; ++x)
+            mtl << "newmtl m" << x << "\nKd 0." << x << " 0.5 0.5\n";
+
+        std::ofstream obj(OBJ_FILE);
+        obj << "mtllib " << MTL_FILE << "\n";
+        const uint32_t row = size + 1;
+        for(uint32_t y = 0; y <= size; ++y) {
+            for(uint32_t x = 0; x <= size; ++x) {
+                const float h = std::sin(x * 0.1f) * std::cos(y * 0.1f);
+                obj << "v " << x * 0.01f << " " << h << " " << y * 0.01f << "\n";
+                obj << "vn 0 1 0\n";
+                obj << "vt " << (float)x / size << " " << (float)y / size << "\n";
+            }
+        }
+
+        const long total = (long)row * row;
+        for(uint32_t y = 0; y < size; ++y) {
+            if(y % 16 == 0) obj << "g rows" << y << "\nusemtl m" << (y / 16) % 3 << "\n";
+            for(uint32_t x = 0; x < size; ++x) {
+                long a = (long)y * row + x + 1, b = a + 1, c = a + row + 1, d = a + row;
+                if((y / 16) % 2) {
+                    a -= total + 1; b -= total + 1; c -= total + 1; d -= total + 1;
+                }
+                obj << "f " << a << "/" << a << "/" << a << " " << b << "/" << b << "/" << b << " "
+                    << c << "/" << c << "/" << c << " " << d << "/" << d << "/" << d << "\n";
+            }
+        }
+    }
+
+    bool close(const std::vector<float>& a, const std::vector<float>& b) {
+        if(a.size() != b.size()) return false;
+        for(size_t x = 0; x < a.size(); ++x)
+            if(std::fabs(a[x] - b[x]) > 1e-6f * std::max(1.0f, std::fabs(a[x]))) return false;
+        return true;
+    }
+
+    bool same(const std::vector<tinyobj::shape_t>& a, const std::vector<tinyobj::shape_t>& b) {
+        if(a.size() != b.size()) return false;
+        for(size_t x = 0; x < a.size(); ++x) {
+            const tinyobj::mesh_t& m = a[x].mesh;
+            const tinyobj::mesh_t& n = b[x].mesh;
+            if(a[x].name != b[x].name || m.indices != n.indices || m.num_vertices != n.num_vertices ||
+               m.material_ids != n.material_ids || !close(m.positions, n.positions) ||
+               !close(m.normals, n.normals) || !close(m.texcoords, n.texcoords))
+                return false;
+        }
+        return true;
+    }
+}
+
+/// Compares FastObj::LoadObj against tinyobj::LoadObj on generated grids
+int Bench::objLoad() {
+    const uint32_t sizes[] = {256, 1024};
+    printf("%u threads\n", ThreadPool::global().size());
+    printf("%6s %10s %12s %12s %8s\n", "size", "MB", "tinyobj ms", "fastobj ms", "speedup");
+
+    int result = 0;
+    for(uint32_t size : sizes) {
+        writeGrid(size);
+        std::ifstream in(OBJ_FILE, std::ios::binary | std::ios::ate);
+        const double mb = in.tellg() / (1024.0 * 1024.0);
+
+        std::vector<tinyobj::shape_t> reference, fast;
+        std::vector<tinyobj::material_t> reference_mats, fast_mats;
+        std::string reference_err, fast_err;
+        bool reference_ok = false, fast_ok = false;
+
+        const unsigned runs = size < 1024 ? 5 : 2;
+        const double tiny_ms = best(runs, [&]() {
+            reference_mats.clear();
+            reference_ok = tinyobj::LoadObj(reference, reference_mats, reference_err, OBJ_FILE);
+        });
+        const double fast_ms = best(runs, [&]() {
+            fast_mats.clear();
+            fast_ok = FastObj::LoadObj(fast, fast_mats, fast_err, OBJ_FILE);
+        });
+
+        printf("%6u %10.1f %12.2f %12.2f %7.1fx\n", size, mb, tiny_ms, fast_ms, tiny_ms / fast_ms);
+
+        if(!reference_ok || !fast_ok || reference_mats.size() != fast_mats.size() || !same(reference, fast)) {
+            printf("output differs from tinyobj at %u: %s\n", size, fast_err.c_str());
+            result = 1;
+            break;
+        }
+    }
+
+    std::remove(OBJ_FILE);
+    std::remove(MTL_FILE);
+    return result;
+}
@@ -0,0 +1,117 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "bench.h"
+#include "scenefile.h"
+
+namespace {
+    const char* const JSON_FILE = "sceneload_bench.json";
+
+    /// A race.json shaped scene with props scattered over a grid
+    void writeScene(uint32_t props) {
+        std::ofstream out(JSON_FILE);
+        out << "{\n\"startPosition\" : [ 3.71, 0, 61.19 ],\n\"startPYR\" : [ 0, 0.3, 0 ],\n"
+            << "\"photoPosition\" : [ -55, 1, -80 ],\n\"observerPosition\" : [ -9, 20, -79 ],\n"
+            << "\"bbox\" : [ -100, 0, -100, 100, 10, 100 ],\n\"lampIntensity\" : [ 1, 1, 0.8 ],\n"
+            << "\"weather\" : { \"sunLightDirection\" : [ 0.4, 1, 0.6 ], \"sunIntensity\" : [ 1, 1, 1 ] },\n";
+
+        out << "\"track\" : { \"leftCurb\" : [";
+        for(uint32_t x = 0; x < 256; ++x) out << (x ? ", " : " ") << x * 0.5f << ", 0, " << x * -0.25f;
+        out << " ], \"rightCurb\" : [";
+        for(uint32_t x = 0; x < 256; ++x) out << (x ? ", " : " ") << x * 0.5f + 8 << ", 0, " << x * -0.25f;
+        out << " ] },\n";
+
+        const auto at = [](uint32_t i, uint32_t salt) { return (float)((i * 37 + salt * 11) % 2000) * 0.1f - 100.0f; };
+        out << "\"trees\" : [\n";
+        for(uint32_t x = 0; x < props; ++x)
+            out << (x ? ",\n" : "") << "{ \"position\" : [ " << at(x, 1) << ", 0, " << at(x, 2)
+                << " ], \"height\" : " << 2 + x % 5 << " }";
+        out << "\n],\n\"buildings\" : [\n";
+        for(uint32_t x = 0; x < props / 4; ++x) {
+            out << (x ? ",\n" : "") << "{ \"outline\" : [";
+            for(int c = 0; c < 4; ++c)
+                out << (c ? ", " : " ") << at(x, c) << ", 0, " << at(x, c + 4) << ", " << 5 + x % 7;
+            out << " ] }";
+        }
+        out << "\n],\n\"lamps\" : [\n";
+        for(uint32_t x = 0; x < 12; ++x)
+            out << (x ? ",\n" : "") << "{ \"position\" : [ " << at(x, 3) << ", 0, " << at(x, 5) << " ], \"height\" : 4 }";
+        out << "\n]\n}\n";
+    }
+
+    bool same(const float* a, const float* b, uint32_t count) {
+        return count == 0 || std::memcmp(a, b, count * sizeof(float)) == 0;
+    }
+
+    bool same(const SceneFile::View& a, const SceneFile::View& b) {
+        return std::memcmp(&a.globals, &b.globals, sizeof(a.globals)) == 0 &&
+               a.tree_count == b.tree_count && a.building_count == b.building_count &&
+               a.lamp_count == b.lamp_count && a.left_curb_count == b.left_curb_count &&
+               a.right_curb_count == b.right_curb_count &&
+               same(a.tree_positions, b.tree_positions, a.tree_count * 3) &&
+               same(a.tree_heights, b.tree_heights, a.tree_count) &&
+               same(a.building_outlines, b.building_outlines, a.building_count * 12) &&
+               same(a.building_heights, b.building_heights, a.building_count * 4) &&
+               same(a.lamp_positions, b.lamp_positions, a.lamp_count * 3) &&
+               same(a.lamp_heights, b.lamp_heights, a.lamp_count) &&
+               same(a.left_curb, b.left_curb, a.left_curb_count) &&
+               same(a.right_curb, b.right_curb, a.right_curb_count);
+    }
+
+    /// Reads every prop once, as World does
+    float touch(const SceneFile::View& v) {
+        float sum = 0.0f;
+        for(uint32_t x = 0; x < v.tree_count * 3; ++x) sum += v.tree_positions[x];
+        for(uint32_t x = 0; x < v.building_count * 12; ++x) sum += v.building_outlines[x];
+        return sum;
+    }
+}
+
+/// Compares parsing race.json style scenes against mapping the compiled scene
+int Bench::sceneLoad() {
+    const uint32_t sizes[] = {36, 10000, 200000};
+    const std::string compiled = SceneFile::pathFor(JSON_FILE);
+    printf("%8s %10s %10s %12s %8s\n", "props", "MB", "json ms", "compiled ms", "speedup");
+
+    int result = 0;
+    volatile float sink = 0.0f;
+    for(uint32_t props : sizes) {
+        writeScene(props);
+        std::ifstream in(JSON_FILE, std::ios::binary | std::ios::ate);
+        const double mb = in.tellg() / (1024.0 * 1024.0);
+
+        SceneFile::Scene parsed;
+        bool parsed_ok = false;
+        const unsigned runs = props < 200000 ? 5 : 2;
+        const double json_ms = best(runs, [&]() {
+            parsed_ok = SceneFile::parseJson(JSON_FILE, parsed);
+            sink = touch(parsed.view());
+        });
+        if(!parsed_ok || !SceneFile::save(compiled, parsed.view(), JSON_FILE)) {
+            printf("could not compile %s\n", JSON_FILE);
+            result = 1;
+            break;
+        }
+
+        MappedFile file;
+        SceneFile::View view;
+        bool loaded_ok = false;
+        const double compiled_ms = best(runs, [&]() {
+            loaded_ok = SceneFile::load(compiled, file, view, JSON_FILE);
+            sink = touch(view);
+        });
+
+        printf("%8u %10.1f %10.2f %12.2f %7.1fx\n", props, mb, json_ms, compiled_ms, json_ms / compiled_ms);
+
+        if(!loaded_ok || !same(parsed.view(), view)) {
+            printf("compiled scene differs from the JSON at %u props\n", props);
+            result = 1;
+            break;
+        }
+    }
+
+    std::remove(JSON_FILE);
+    std::remove(compiled.c_str());
+    return result;
+}
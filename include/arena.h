@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Bump allocator for things that live exactly as long as their owner, e.g. the
+ * meshes and materials of a World. Allocating moves a pointer along a large
+ * block, and everything is destroyed and freed at once with the arena.
+ *
+ * Memory of objects that die earlier is not reused until then. Not thread
+ * safe, only allocate from one thread at a time.
+ */
+class Arena {
+    struct Block {
+        Block* next;
+        size_t size;
+    };
+
+    /// Destructors still to run, newest first
+    struct Finalizer {
+        void (*destroy)(void*);
+        void* object;
+        Finalizer* next;
+    };
+
+    Block* blocks;
+    uint8_t* cursor;
+    uint8_t* end;
+    Finalizer* finalizers;
+    size_t block_size;
+    size_t m_allocations;
+    size_t m_bytes;
+    size_t m_blocks;
+
+    template<class T> static void destroyObject(void* p) { static_cast<T*>(p)->~T(); }
+
+public:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    explicit Arena(size_t block_size = BLOCK_SIZE);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /// @return bytes of uninitialised storage, valid until clear()
+    void* allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+
+    /// Constructs a T in the arena, it is destroyed by clear()
+    template<class T, class... Args> T* make(Args&&... args) {
+        void* p = allocate(sizeof(T), alignof(T));
+        T* object = new(p) T(std::forward<Args>(args)...);
+        if(!std::is_trivially_destructible<T>::value) {
+            Finalizer* f = static_cast<Finalizer*>(allocate(sizeof(Finalizer), alignof(Finalizer)));
+            f->destroy = &destroyObject<T>;
+            f->object = object;
+            f->next = finalizers;
+            finalizers = f;
+        }
+        return object;
+    }
+
+    /**
+     * std::make_shared into the arena, the object is destroyed with its last
+     * reference as usual. Every reference must be gone before the arena is.
+     */
+    template<class T, class... Args> std::shared_ptr<T> share(Args&&... args);
+
+    /// Runs the destructors of make() and frees every block
+    void clear();
+
+    size_t allocations() const { return m_allocations; }
+    /// Handed out, padding included
+    size_t bytes() const { return m_bytes; }
+    /// Calls to the heap
+    size_t blocksAllocated() const { return m_blocks; }
+};
+
+/// Standard allocator over an Arena, deallocate() does nothing
+template<class T> struct ArenaAllocator {
+    typedef T value_type;
+    Arena* arena;
+
+    explicit ArenaAllocator(Arena& arena) : arena(&arena) {}
+    template<class U> ArenaAllocator(const ArenaAllocator<U>& other) : arena(other.arena) {}
+
+    T* allocate(size_t n) { return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T))); }
+    void deallocate(T*, size_t) {}
+};
+
+template<class T, class U>
+inline bool operator==(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena == b.arena; }
+template<class T, class U>
+inline bool operator!=(const ArenaAllocator<T>& a, const ArenaAllocator<U>& b) { return a.arena != b.arena; }
+
+template<class T, class... Args> std::shared_ptr<T> Arena::share(Args&&... args) {
+    return std::allocate_shared<T>(ArenaAllocator<T>(*this), std::forward<Args>(args)...);
+}
+
+/// arena->share<T>(), or std::make_shared<T>() for things which may die well before the arena
+template<class T, class... Args> std::shared_ptr<T> shareIn(Arena* arena, Args&&... args) {
+    if(arena == nullptr) return std::make_shared<T>(std::forward<Args>(args)...);
+    return arena->share<T>(std::forward<Args>(args)...);
+}
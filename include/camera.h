@@ -1,3 +1,5 @@
+#pragma once
+
 #include <glm/glm.hpp>
 
 class Camera { // TODO: have this extend a mobile class which is also used for car
@@ -12,6 +14,12 @@ private:
     /// Width / Height
     float aspect;
 
+    /// Built on demand, every change to the camera marks them stale
+    mutable glm::mat4 view;
+    mutable glm::mat4 projection;
+    mutable bool view_dirty;
+    mutable bool projection_dirty;
+
     /// @return cos(a) when a is the angle between vector and the up direction
     inline float getTopAngle(const glm::vec3& vec) { return glm::dot(vec, glm::vec3(0, 1.0f, 0)); }
 
@@ -23,6 +31,7 @@ public:
     inline void setViewVolume(float fovy, float aspect, float near_plane, float far_plane) {
         this->fovy = fovy; this->aspect = aspect;
         this->near_plane = near_plane; this->far_plane    = far_plane;
+        projection_dirty = true;
     }
 
     void slide(const glm::vec3& d);
@@ -32,13 +41,19 @@ public:
     void rotate(float angle, const glm::vec3& axis);
     void pitch(float angle);
 
-    void setAspect(float a) { aspect = a; }
+    void setAspect(float a) { aspect = a; projection_dirty = true; }
 
-    glm::mat4 getProjectionMatrix() const;
-    glm::mat4 getViewMatrix() const;
+    const glm::mat4& getProjectionMatrix() const;
+    const glm::mat4& getViewMatrix() const;
 
     glm::vec3 getPosition() const { return position; }
     glm::vec3 getU() const { return u; }
     glm::vec3 getV() const { return v; }
     glm::vec3 getN() const { return n; }
+
+    /**
+     * A camera t of the way from a to b, for drawing between two simulation
+     * ticks. The view volume is b's.
+     */
+    static Camera interpolate(const Camera& a, const Camera& b, float t);
 };
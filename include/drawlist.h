@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "entitystore.h"
+
+/**
+ * The draws of one frame. build() culls, picks what is worth drawing and
+ * writes a packet per draw, in jobs over ranges of the EntityStore, each
+ * range into its own buffer. The buffers are then merged in pairs into one
+ * list, sorted so submit() can skip state that does not change between draws.
+ *
+ * Only submit() touches OpenGL, call it on the thread owning the context.
+ * The list indexes the store, so submit it before the store changes.
+ */
+class DrawList {
+public:
+    struct Packet {
+        /// Material, then mesh, then distance, see build()
+        uint64_t key;
+        /// Index into the EntityStore arrays
+        uint32_t entity;
+    };
+
+    /**
+     * Entities whose bounding sphere is smaller than this, relative to its
+     * distance, are left out. 0.001 is about a pixel at 45 degrees and 600
+     * pixels high.
+     */
+    static constexpr float MIN_SIZE = 0.001f;
+    /// Entities per job
+    static const size_t BLOCK = 1024;
+
+    /// Sorted, valid after build()
+    std::vector<Packet> packets;
+
+    /// @param eye Where the camera is, for distances
+    void build(const EntityStore& store, const glm::mat4& view_proj, const glm::vec3& eye,
+               float min_size = MIN_SIZE);
+
+    /// Draws every packet, on the GL thread
+    void submit(const EntityStore& store, Shader& shader) const;
+
+    /// Entities left out by the size test in the last build()
+    inline size_t tooSmall() const { return too_small; }
+
+private:
+    /// One per BLOCK of entities, kept between frames
+    std::vector< std::vector<Packet> > buffers;
+    /// Where buffers are merged into before being swapped back, see build()
+    std::vector< std::vector<Packet> > merged;
+    std::vector<size_t> small_counts;
+    size_t too_small;
+};
@@ -2,6 +2,7 @@
 
 #include <memory>
 
+#include "pool.h"
 #include "shader.h"
 #include "shapes.h"
 #include "material.h"
@@ -38,7 +39,7 @@ struct SceneEntity {
             shader(s), mesh(m), transform(t), material(c), normal_map(normal_map) {
 
         if(m == nullptr) mesh = std::shared_ptr<Mesh>(new Cube(1.0f));
-        if(t == nullptr) transform = std::shared_ptr<glm::mat4>(new glm::mat4(1.0f));
+        if(t == nullptr) transform = pooled<glm::mat4>(1.0f);
     }
 
     virtual ~SceneEntity() {}
@@ -54,6 +55,7 @@ struct SceneEntity {
         mesh->render();
     }
 
+    virtual void prepareMesh() { mesh->prepare(); }
     virtual void initMesh() { mesh->init(); }
 };
 
@@ -69,6 +71,7 @@ struct SceneEntity {
  */
 class MultiEntity : public SceneEntity {
     MultiEntity* next; //For safty reasons, prevent outsiders from reaching this
+    friend class EntityStore;
 
 public:
     /// This moves the entire group. Only the one stored in the master obj is considered.
@@ -89,6 +92,15 @@ public:
         delete next;
     }
 
+    /// Chains are built and dropped by the thousand, so plain MultiEntities come from a pool
+    static void* operator new(size_t size) {
+        return size == sizeof(MultiEntity) ? Pool<MultiEntity>::global().allocate() : ::operator new(size);
+    }
+    static void operator delete(void* p, size_t size) {
+        if(size == sizeof(MultiEntity)) Pool<MultiEntity>::global().deallocate(p);
+        else ::operator delete(p);
+    }
+
     virtual void render(const glm::mat4& additional_transform = glm::mat4()) {
         for(MultiEntity* i = this; i != nullptr; i = i->next)
             i->SceneEntity::render(additional_transform * objtowld);
@@ -125,6 +137,11 @@ public:
         return i;
     }
 
+    virtual void prepareMesh() {
+        for(MultiEntity* i = this; i != nullptr; i = i->next)
+            i->SceneEntity::prepareMesh();
+    }
+
     virtual void initMesh() {
         for(MultiEntity* i = this; i != nullptr; i = i->next)
             i->SceneEntity::initMesh();
@@ -183,6 +200,10 @@ public:
     virtual void turn(float angle);
 
 
+    const glm::mat4& getMobTransform() const { return mob_transform; }
+
+    /// A mob transform t of the way from a to b, for drawing between two simulation ticks
+    static glm::mat4 interpolate(const glm::mat4& a, const glm::mat4& b, float t);
     const glm::vec3& getPosition()  { return position; }
     const glm::vec3& getDirection() { return direction; }
     const glm::vec3& getUp()        { return up; }
@@ -0,0 +1,154 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "entity.h"
+
+/**
+ * Every drawable in the world as parallel arrays, one entry per entity, so
+ * rendering and the other systems walk memory in order instead of chasing
+ * pointers through entity objects.
+ *
+ * Entries are kept dense: destroying one moves the last into its place. Ids
+ * stay valid until destroyed, index() finds where an entity currently is.
+ * Meshes and materials live in tables and are shared by handle, a mesh is
+ * released once no entity uses it.
+ *
+ * SceneEntity and MultiEntity are still how entities are described (see
+ * MeshMaker), add() flattens them into the store.
+ *
+ * Each entity has a local transform, relative to its pivot if it has one.
+ * Pivots are the moving parts of the world (the car), they form a hierarchy
+ * of their own. World transforms are cached and only recomputed by
+ * updateTransforms() for entities whose local transform or pivot changed, so
+ * a frame where nothing moved costs nothing.
+ */
+class EntityStore {
+public:
+    typedef uint32_t Id;
+    typedef uint32_t MeshHandle;
+    typedef uint32_t MaterialHandle;
+    typedef uint32_t Pivot;
+
+    /// For entities whose mesh sets its own materials
+    static const MaterialHandle NO_MATERIAL = 0;
+    /// For entities and pivots placed directly in the world
+    static const Pivot NO_PIVOT = 0xffffffff;
+    /// Handles fit this many bits of a DrawList sort key, more is fatal
+    static const unsigned MESH_BITS = 20;
+    static const unsigned MATERIAL_BITS = 12;
+
+    enum Flags {
+        NORMAL_MAP = 1,
+        /// The local transform changed since the last updateTransforms()
+        DIRTY = 2
+    };
+
+    struct Bounds {
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    /// The entities made from one MultiEntity, e.g. the trunk, caps and top of a tree
+    typedef std::vector<Id> Group;
+
+    /// Relative to the entity's pivot, or to the world if it has none, see setLocal()
+    std::vector<glm::mat4> locals;
+    std::vector<Pivot> pivots;
+    /// Object to world, derived from locals and pivots by updateTransforms()
+    std::vector<glm::mat4> transforms;
+    std::vector<MeshHandle> meshes;
+    std::vector<MaterialHandle> materials;
+    std::vector<uint8_t> flags;
+    /// World space, only valid once the mesh has been prepared, see updateBounds()
+    std::vector<Bounds> bounds;
+
+    EntityStore();
+    ~EntityStore();
+
+    EntityStore(const EntityStore&) = delete;
+    EntityStore& operator=(const EntityStore&) = delete;
+
+    Id create(MeshHandle mesh, MaterialHandle material, const glm::mat4& local, uint8_t flags = 0,
+              Pivot pivot = NO_PIVOT);
+    void destroy(Id id);
+
+    /**
+     * Adds every entity in the chain of e, with its transforms baked into
+     * their world transforms.
+     * @param parent Applied on top of e's own transforms
+     */
+    Group add(const MultiEntity& e, const glm::mat4& parent = glm::mat4());
+    /// Adds every entity in the chain of e, following pivot, e.g. a MobileEntity's
+    Group add(const MultiEntity& e, Pivot pivot);
+    /// Adds e alone
+    Group add(const SceneEntity& e);
+    void destroy(const Group& group);
+
+    void setLocal(Id id, const glm::mat4& local);
+
+    /**
+     * Pivots live as long as the store, a parent must be created before its
+     * children.
+     */
+    Pivot createPivot(const glm::mat4& local, Pivot parent = NO_PIVOT);
+    /// Moves pivot and everything under it, nothing is marked if local is unchanged
+    void setPivot(Pivot pivot, const glm::mat4& local);
+    /// Only up to date after updateTransforms()
+    inline const glm::mat4& pivotTransform(Pivot pivot) const { return pivot_worlds[pivot]; }
+
+    /// Recomputes the world transforms and bounds of what moved since last time
+    void updateTransforms();
+
+    /// @return Where id currently is in the arrays
+    inline uint32_t index(Id id) const { return dense[id]; }
+    inline size_t size() const { return transforms.size(); }
+
+    /// The same mesh always gets the same handle
+    MeshHandle addMesh(const std::shared_ptr<Mesh>& mesh);
+    MaterialHandle addMaterial(const std::shared_ptr<Material>& material);
+    inline Mesh& mesh(MeshHandle handle) const { return *mesh_table[handle]; }
+    inline Material& material(MaterialHandle handle) const { return *material_table[handle]; }
+
+    /// Each mesh used by group once, e.g. for preparing them on another thread
+    std::vector< std::shared_ptr<Mesh> > meshesOf(const Group& group) const;
+    std::vector< std::shared_ptr<Mesh> > meshesOf(const std::vector<Group>& groups) const;
+
+    /// Uploads every mesh which is not yet, needs an OpenGL context
+    void initMeshes();
+    /// Recomputes the world space bounds of every entity from its mesh's
+    void updateBounds();
+    /// Draws everything in array order, see DrawList for drawing what is visible
+    void render(Shader& shader) const;
+
+private:
+    /// Id to index, INVALID once destroyed
+    std::vector<uint32_t> dense;
+    /// Index to id
+    std::vector<Id> ids;
+    std::vector<Id> free_ids;
+
+    std::vector< std::shared_ptr<Mesh> > mesh_table;
+    /// Entities using each mesh
+    std::vector<uint32_t> mesh_users;
+    std::vector<MeshHandle> free_meshes;
+    std::unordered_map<const Mesh*, MeshHandle> mesh_lookup;
+
+    std::vector< std::shared_ptr<Material> > material_table;
+    std::unordered_map<const Material*, MaterialHandle> material_lookup;
+
+    std::vector<glm::mat4> pivot_locals;
+    std::vector<glm::mat4> pivot_worlds;
+    std::vector<Pivot> pivot_parents;
+    std::vector<uint8_t> pivot_dirty;
+    /// Whether updateTransforms() has anything to do
+    bool dirty;
+
+    static const uint32_t INVALID = 0xffffffff;
+
+    Bounds worldBounds(MeshHandle mesh, const glm::mat4& transform) const;
+};
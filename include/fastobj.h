@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "tiny_obj_loader.h"
+
+/**
+ * A drop in replacement for tinyobj::LoadObj for large models. The file is
+ * memory mapped and split into chunks of whole lines which are parsed in
+ * parallel, then stitched back together in file order. The shapes, indices
+ * and material ids come out the same as tinyobj's. Floats are parsed with a
+ * faster routine, so they can differ from tinyobj's in the last bit.
+ *
+ * Tags ("t" lines, for subdivision surfaces) are not supported and skipped.
+ * Materials are read with tinyobj::LoadMtl.
+ */
+namespace FastObj {
+
+    /// @see tinyobj::LoadObj
+    bool LoadObj(std::vector<tinyobj::shape_t>& shapes,
+                 std::vector<tinyobj::material_t>& materials,
+                 std::string& err,
+                 const char* filename, const char* mtl_basepath = NULL,
+                 bool triangulate = true);
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+/**
+ * Frame timings of one run, printed when it ends to compare how the view is
+ * hosted. Frames are added from whichever thread sees them presented.
+ */
+class FrameStats {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    /// Samples kept of each kind, later ones are dropped
+    static const size_t MAX_SAMPLES = 1 << 20;
+
+    /**
+     * @param draw_ms   Time the render thread spent drawing the frame
+     * @param presented When the frame was handed to the display
+     * @param input     When the oldest input the frame shows the effect of
+     *                  arrived, or the epoch for none. Frames repeating the
+     *                  input of the one before only count once.
+     */
+    void add(double draw_ms, Clock::time_point presented, Clock::time_point input);
+
+    /// Count, mean, median and 99th percentile of each kind
+    void print(const char* title) const;
+
+private:
+    mutable std::mutex lock;
+    std::vector<double> draw_ms;
+    /// Between consecutive presents
+    std::vector<double> interval_ms;
+    /// Input to present
+    std::vector<double> latency_ms;
+    Clock::time_point last_presented;
+    Clock::time_point last_input;
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * The per-texel work behind Procedural::generateHeightMap. There is one
+ * implementation per instruction set, heightRow() picks the widest one the
+ * CPU supports the first time it is called.
+ */
+namespace HeightKernel {
+
+    /**
+     * Evaluates the height map noise for n texels of one row.
+     *
+     * @param row    Row of the texels
+     * @param column Column of the first texel
+     * @param n      Number of texels
+     * @param out    n values, not yet normalized
+     */
+    typedef void (*RowFunction)(uint32_t row, uint32_t column, uint32_t n, float* out);
+
+    /// Uses glm::simplex, this is the reference for the others
+    void rowScalar(uint32_t row, uint32_t column, uint32_t n, float* out);
+    /// 4 texels at a time
+    void rowSSE2(uint32_t row, uint32_t column, uint32_t n, float* out);
+    /// 8 texels at a time
+    void rowAVX2(uint32_t row, uint32_t column, uint32_t n, float* out);
+
+    /// @return The best implementation for this CPU
+    RowFunction heightRow();
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <QFile>
+#include <cstdint>
+#include <string>
+
+/**
+ * A read only memory mapping of a whole file. The pages are only read from
+ * disk when touched, and stay valid until the MappedFile is closed.
+ */
+class MappedFile {
+    QFile file;
+    const uint8_t* m_data;
+    size_t m_size;
+
+public:
+    MappedFile() : m_data(nullptr), m_size(0) {}
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    /// @return false if the file could not be opened or mapped
+    bool open(const std::string& file_name);
+    void close();
+
+    inline bool isOpen() const { return m_data != nullptr; }
+    inline const uint8_t* data() const { return m_data; }
+    inline size_t size() const { return m_size; }
+};
@@ -1,7 +1,10 @@
 #pragma once
 
 #include <QOpenGLFunctions_4_1_Core>
+#include <glm/glm.hpp>
+#include <mutex>
 #include <vector>
+#include "meshdata.h"
 #include "shader.h"
 
 #define PUSH_BACK3(vector, a, b, c) {   \
@@ -25,8 +28,16 @@ protected:
     /// they must be described by 9 indices, so this value would be 9.
     GLuint m_elements;
 
+    /// Object space bounding box, set once the geometry is known
+    glm::vec3 m_min;
+    glm::vec3 m_max;
+    bool m_has_bounds;
+
+    /// Sets the bounding box to that of positions, 3 floats per vertex
+    void setBounds(const GLfloat* positions, GLuint vertices);
+
 public:
-    Mesh() : m_vao(0), m_elements(0) {}
+    Mesh() : m_vao(0), m_elements(0), m_min(0.0f), m_max(0.0f), m_has_bounds(false) {}
     virtual ~Mesh() { destroy(); }
 
     /**
@@ -34,24 +45,45 @@ public:
     * Make sure a valid OpenGL context is current before calling this method.
     */
     virtual void destroy();
+
+    /**
+     * Does the CPU side of init(), e.g. loading or generating geometry, so it
+     * can run on a worker thread ahead of time. This must not touch OpenGL.
+     * init() calls it itself if it has not been called yet.
+     */
+    virtual void prepare() {}
     virtual void init() = 0;
     virtual void render() = 0;
     virtual void setUniform(Shader&) {}
 
     virtual inline bool isInit() { return m_vao != 0;}
+
+    /// @return false until prepare() has run
+    inline bool bounds(glm::vec3& min, glm::vec3& max) const {
+        min = m_min;
+        max = m_max;
+        return m_has_bounds;
+    }
 };
 
 
 /**
  * An abstract class representing an object with only triangles.
  * Call init once OpenGL is ready, and then render as desired.
+ *
+ * Most subclasses only implement build(), prepare() runs it (from any thread)
+ * and init() uploads the result.
  */
 class TriangleMesh : public Mesh {
+    /// Built by prepare(), released once uploaded
+    MeshData m_pending;
+    std::once_flag m_prepared;
+
 protected:
     /**
      * Copies the vertex data to OpenGL GPU buffers and sets up a VAO for using
      * the buffers. Points normals, and texCoords must have same number of verts
-     * if not null.
+     * if not null. The arrays are optimized in place first, see MeshOpt::optimize.
      *
      * @param triangles Indices describing the faces of the mesh. Each index referes to first of vertex, so index 2 would be at 6 in the array.
      * @param points    Position data, assumed to be stored in [x0, y0, z0, x1, y1, z1, ...] format.
@@ -67,6 +99,31 @@ protected:
         std::vector<GLfloat>*  texCoords = NULL
     );
 
+    /**
+     * Same as the other init, but copies from raw arrays, e.g. straight out of
+     * a memory mapped file. Every array given must hold vertices entries.
+     *
+     * @param triangles Indices describing the faces of the mesh
+     * @param elements  Number of indices
+     * @param points    Position data, 3 floats per vertex
+     * @param vertices  Number of vertices
+     * @param normals   3 floats per vertex, may be null
+     * @param colors    4 floats per vertex, may be null
+     * @param texCoords 2 floats per vertex, may be null
+     */
+    void init(
+        const GLuint*  triangles,
+        GLuint         elements,
+        const GLfloat* points,
+        GLuint         vertices,
+        const GLfloat* normals   = nullptr,
+        const GLfloat* colors    = nullptr,
+        const GLfloat* texCoords = nullptr
+    );
+
+    /// Copies data to OpenGL buffers, see the init above
+    void upload(const MeshData& data);
+
 public:
     /// Creates an empty TriangleMesh
     TriangleMesh() {}
@@ -75,10 +132,16 @@ public:
     virtual ~TriangleMesh() { destroy(); }
 
     /**
-     * Constructs the data based on a mathematical shape. The implimenting child
-     * needs to then call the other init to initlize the GPU buffers.
+     * Generates the geometry on the CPU. This must not touch OpenGL or modify
+     * the mesh, so it is safe to call from any thread.
      */
-    virtual void init() = 0;
+    virtual MeshData build() const { return MeshData(); }
+
+    /// Builds and optimizes the geometry, only the first call does anything
+    virtual void prepare();
+
+    /// Uploads what prepare() built, preparing first if needed
+    virtual void init();
 
     virtual void render();
 };
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <QOpenGLFunctions_4_1_Core>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+#include "material.h"
+
+/**
+ * Stores the final buffers of a model loaded from a text format next to the
+ * source file, so later runs can map them and upload them without parsing.
+ * A cache is only used while the source's size, modification time and
+ * contents match what it was built from.
+ */
+namespace MeshCache {
+
+    /// A range of indices drawn with one material
+    struct Part {
+        uint32_t count;
+        uint32_t start;
+        uint32_t material;
+    };
+
+    /// Everything needed to draw a model
+    struct MeshData {
+        std::vector<GLfloat> positions;
+        std::vector<GLfloat> normals;
+        std::vector<GLuint> indices;
+        std::vector<Part> parts;
+        std::vector<Material> materials;
+        glm::vec3 min;
+        glm::vec3 max;
+    };
+
+    /// A cache file mapped into memory, the arrays point straight into the mapping
+    struct View {
+        MappedFile file;
+        uint32_t vertex_count;
+        uint32_t index_count;
+        uint32_t part_count;
+        const GLfloat* positions;
+        const GLfloat* normals;
+        const GLuint* indices;
+        const Part* parts;
+        /// Small enough to copy out
+        std::vector<Material> materials;
+        glm::vec3 min;
+        glm::vec3 max;
+
+        View() : vertex_count(0), index_count(0), part_count(0),
+                 positions(nullptr), normals(nullptr), indices(nullptr), parts(nullptr) {}
+    };
+
+    /// @return Where the cache of source is kept
+    std::string pathFor(const std::string& source);
+
+    /**
+     * @param source The model the cache was built from
+     * @param view   Output, only valid if this succeeds
+     * @return       false if there is no cache, or it is stale or corrupt
+     */
+    bool load(const std::string& source, View& view);
+
+    /// @return false if the cache could not be written
+    bool save(const std::string& source, const MeshData& data);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QOpenGLFunctions_4_1_Core>
+#include <vector>
+
+#include "meshopt.h"
+
+/**
+ * The geometry of a TriangleMesh as plain arrays. Building one never touches
+ * OpenGL, so it can be done on any thread (or without a context at all), and
+ * TriangleMesh::upload copies it to the GPU afterwards.
+ */
+struct MeshData {
+    std::vector<GLuint>  indices;
+    /// 3 floats per vertex
+    std::vector<GLfloat> positions;
+    /// Either empty or 3 floats per vertex
+    std::vector<GLfloat> normals;
+    /// Either empty or 4 floats per vertex
+    std::vector<GLfloat> colors;
+    /// Either empty or 2 floats per vertex
+    std::vector<GLfloat> texcoords;
+
+    inline GLuint vertexCount() const { return positions.size() / 3; }
+
+    /// Runs MeshOpt::optimize over every array that is not empty
+    MeshOpt::Report optimize();
+};
@@ -1,33 +1,38 @@
 #pragma once
 
+#include "arena.h"
 #include "entity.h"
 
+/**
+ * Meshes come from arena and live until it is cleared, or from the heap if it
+ * is null. Transforms and the MultiEntities themselves come from pools.
+ */
 namespace MeshMaker {
     /**
      * Draw the cap on a Cone.
      * @return A MultiEntity including the Cone and Disk s.
      */
-    MultiEntity* cappedCone(const SceneEntity& e);
+    MultiEntity* cappedCone(Arena* arena, const SceneEntity& e);
 
     /**
      * Draw the caps on a Cylinder.
      * @return A MultiEntity including the Cylinder and Disk s.
      */
-    MultiEntity* cappedCylider(const SceneEntity& e);
+    MultiEntity* cappedCylider(Arena* arena, const SceneEntity& e);
 
     /**
      * Returns a MultiEntity representing a tree.
      *
      * @param  h The height of the tree
      */
-    MultiEntity* tree(Shader& s, float h, std::shared_ptr<Material> trunk, std::shared_ptr<Material> top);
+    MultiEntity* tree(Arena* arena, Shader& s, float h, std::shared_ptr<Material> trunk, std::shared_ptr<Material> top);
 
     /**
      * Returns a MultiEntity representing a lamp.
      *
      * @param  h The height of the lamp
      */
-    MultiEntity* lamp(Shader& s, float h, std::shared_ptr<Material> post, std::shared_ptr<Material> top);
+    MultiEntity* lamp(Arena* arena, Shader& s, float h, std::shared_ptr<Material> post, std::shared_ptr<Material> top);
 
     /**
      * Draw a basic car with its orgin in the center.
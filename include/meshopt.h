@@ -0,0 +1,78 @@
+#pragma once
+
+#include <QOpenGLFunctions_4_1_Core>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Reorders indexed triangle lists so the GPU does less work drawing them:
+ * duplicate vertices are welded, triangles are ordered for the post transform
+ * vertex cache (Tipsify) and then for overdraw, and finally vertices are laid
+ * out in the order they are first used.
+ *
+ * Triangles keep their winding, and vertices are only merged when every
+ * attribute is bit for bit the same, so the mesh renders identically.
+ */
+namespace MeshOpt {
+
+    /// Size of the FIFO vertex cache that is optimized for and simulated
+    const unsigned CACHE_SIZE = 16;
+
+    /// One per vertex attribute array
+    struct Stream {
+        std::vector<GLfloat>* data;
+        /// Floats per vertex
+        unsigned components;
+    };
+
+    /// A range of indices which is drawn on its own, triangles never move between ranges
+    struct Range {
+        GLuint start;
+        GLuint count;
+    };
+
+    struct Report {
+        GLuint vertices_before;
+        GLuint vertices_after;
+        /// Average cache misses per triangle
+        float acmr_before;
+        float acmr_after;
+    };
+
+    /**
+     * Average cache miss ratio of a FIFO cache, 0.5 is ideal for a large
+     * regular grid and 3 is the worst case.
+     */
+    float acmr(const GLuint* indices, size_t count, GLuint vertices, unsigned cache_size = CACHE_SIZE);
+
+    /**
+     * Merges vertices which are the same in every stream.
+     * @return The new number of vertices, the streams are resized to match
+     */
+    GLuint weld(std::vector<GLuint>& indices, const std::vector<Stream>& streams);
+
+    /// Reorders triangles for the vertex cache, see Sander et al. "Fast Triangle Reordering"
+    void optimizeVertexCache(GLuint* indices, size_t count, GLuint vertices);
+
+    /**
+     * Splits cache ordered triangles into clusters and draws the outward facing
+     * ones first, so they occlude the rest.
+     *
+     * @param positions 3 floats per vertex
+     * @param threshold How much worse the ACMR may get to allow more clusters
+     */
+    void optimizeOverdraw(GLuint* indices, size_t count, const GLfloat* positions, GLuint vertices,
+                          float threshold = 1.05f);
+
+    /// Renumbers vertices in the order they are first used, unused ones are dropped
+    void optimizeVertexFetch(std::vector<GLuint>& indices, const std::vector<Stream>& streams);
+
+    /**
+     * Runs every step above.
+     *
+     * @param streams The first must be the positions
+     * @param ranges  Each is ordered on its own, empty for the whole index buffer
+     */
+    Report optimize(std::vector<GLuint>& indices, const std::vector<Stream>& streams,
+                    const std::vector<Range>& ranges = std::vector<Range>());
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <cstdint>
+
+/**
+ * The per-texel work behind Procedural::generateNormalMap. Rows are
+ * independent, so callers are free to split a map into bands of rows.
+ */
+namespace NormalKernel {
+
+    /**
+     * Computes one row of a normal map. Neighbours wrap around the edges of
+     * the height map.
+     *
+     * @param w          width (number of columns)
+     * @param h          height (number of rows)
+     * @param height_map A map of data[row][colum] height values
+     * @param row        The row to compute
+     * @param out        The row's w texels as [0=r, 1=g, 2=b, 3=a]
+     */
+    typedef void (*RowFunction)(uint32_t w, uint32_t h, const uint8_t* height_map, uint32_t row, uint8_t* out);
+
+    /// One texel at a time, this is the reference for the others
+    void rowScalar(uint32_t w, uint32_t h, const uint8_t* height_map, uint32_t row, uint8_t* out);
+    /// 4 texels at a time, the edge columns are done by the scalar code
+    void rowSSE2(uint32_t w, uint32_t h, const uint8_t* height_map, uint32_t row, uint8_t* out);
+
+    /// @return The best implementation for this CPU
+    RowFunction normalRow();
+}
@@ -4,6 +4,7 @@
 
 #include "material.h"
 #include "mesh.h"
+#include "meshcache.h"
 #include "shader.h"
 
 class ObjMesh : public TriangleMesh {
@@ -15,16 +16,43 @@ class ObjMesh : public TriangleMesh {
 
     std::string fileName;
     std::vector<Material> materials;
+    /// One per material, in material order
     std::vector<ObjShape> parts;
 
+    /// Uniform buffer holding every material, 0 if there are too many for it
+    GLuint materialBuffer;
+    /// The parts as glMultiDrawElements arguments
+    std::vector<GLsizei> drawCounts;
+    std::vector<const GLvoid*> drawOffsets;
+
+    /// Filled by prepare(), released once uploaded
+    bool prepared;
+    bool fromCache;
+    MeshCache::View cache;
+    MeshCache::MeshData built;
+    std::vector<GLfloat> vertexMats;
+
     Shader& shader;
 
     void generateNormals( std::vector<GLfloat> &pts, std::vector<GLfloat> &norm, std::vector<GLuint> &faces);
 
+    /// Gives every vertex the material of the part that uses it
+    std::vector<GLfloat> vertexMaterials(const GLuint* el, GLuint vertices) const;
+
+    /// Uploads the per vertex materials and the material block, once the VAO exists
+    void initMaterials(const std::vector<GLfloat>& perVertex);
+
 public:
+    /// Size of the Materials block in flat.frag
+    static const GLuint MAX_MATERIALS = 128;
+    /// Binding point of the Materials block
+    static const GLuint MATERIAL_BINDING = 0;
+
     ObjMesh(const std::string & fName, Shader& s);
     virtual ~ObjMesh();
 
+    /// Loads the model, from the mesh cache if it is up to date
+    virtual void prepare();
     virtual void init();
     virtual void render();
 };
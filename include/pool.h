@@ -0,0 +1,177 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+/// What every Pool counts, totals() adds up all pools alive
+class PoolBase {
+public:
+    struct Counts {
+        /// Slots handed out
+        size_t allocations;
+        /// Of those, how many were a released slot rather than a fresh one
+        size_t reuses;
+        /// Calls to the heap, one per chunk
+        size_t chunks;
+    };
+
+    Counts counts() const {
+        std::lock_guard<std::mutex> guard(lock);
+        return m_counts;
+    }
+
+    static Counts totals() {
+        Counts sum = { 0, 0, 0 };
+        std::lock_guard<std::mutex> guard(registryLock());
+        for(auto&& i : registry()) {
+            const Counts c = i->counts();
+            sum.allocations += c.allocations;
+            sum.reuses += c.reuses;
+            sum.chunks += c.chunks;
+        }
+        return sum;
+    }
+
+protected:
+    Counts m_counts;
+    mutable std::mutex lock;
+
+    PoolBase() {
+        m_counts.allocations = m_counts.reuses = m_counts.chunks = 0;
+        std::lock_guard<std::mutex> guard(registryLock());
+        registry().push_back(this);
+    }
+    ~PoolBase() {
+        std::lock_guard<std::mutex> guard(registryLock());
+        registry().erase(std::find(registry().begin(), registry().end(), this));
+    }
+
+private:
+    static std::mutex& registryLock() { static std::mutex* m = new std::mutex(); return *m; }
+    static std::vector<PoolBase*>& registry() { static auto* r = new std::vector<PoolBase*>(); return *r; }
+};
+
+/**
+ * Fixed size slots for one type, carved out of chunks and recycled through a
+ * free list. Meant for objects made and dropped in large numbers, e.g. the
+ * MultiEntity chains MeshMaker builds for every prop, which then keep reusing
+ * the same few slots instead of each going to the heap.
+ *
+ * Chunks are only returned to the heap with the pool.
+ */
+template<class T> class Pool : public PoolBase {
+    union Slot {
+        Slot* next;
+        alignas(T) unsigned char storage[sizeof(T)];
+    };
+
+    std::vector<Slot*> m_chunks;
+    /// Released slots
+    Slot* free_slots;
+    /// Never used slots left in the newest chunk
+    Slot* fresh;
+    Slot* fresh_end;
+    size_t chunk_slots;
+    size_t m_live;
+
+public:
+    static const size_t CHUNK_SLOTS = 256;
+
+    explicit Pool(size_t chunk_slots = CHUNK_SLOTS) :
+        free_slots(nullptr), fresh(nullptr), fresh_end(nullptr), chunk_slots(chunk_slots),
+        m_live(0) {}
+    ~Pool() {
+        for(auto&& i : m_chunks) delete[] i;
+    }
+
+    Pool(const Pool&) = delete;
+    Pool& operator=(const Pool&) = delete;
+
+    /// Never destroyed, so anything released during static destruction still has a pool to go to
+    static Pool& global() {
+        static Pool* pool = new Pool();
+        return *pool;
+    }
+
+    /// @return Uninitialised storage for one T
+    void* allocate() {
+        std::lock_guard<std::mutex> guard(lock);
+        ++m_counts.allocations;
+        ++m_live;
+        if(free_slots != nullptr) {
+            ++m_counts.reuses;
+            Slot* slot = free_slots;
+            free_slots = slot->next;
+            return slot->storage;
+        }
+        if(fresh == fresh_end) {
+            fresh = new Slot[chunk_slots];
+            fresh_end = fresh + chunk_slots;
+            m_chunks.push_back(fresh);
+            ++m_counts.chunks;
+        }
+        return (fresh++)->storage;
+    }
+
+    void deallocate(void* p) {
+        if(p == nullptr) return;
+        std::lock_guard<std::mutex> guard(lock);
+        Slot* slot = reinterpret_cast<Slot*>(p);
+        slot->next = free_slots;
+        free_slots = slot;
+        --m_live;
+    }
+
+    template<class... Args> T* create(Args&&... args) {
+        void* p = allocate();
+        try {
+            return new(p) T(std::forward<Args>(args)...);
+        } catch(...) {
+            deallocate(p);
+            throw;
+        }
+    }
+
+    void destroy(T* p) {
+        if(p == nullptr) return;
+        p->~T();
+        deallocate(p);
+    }
+
+    /// Slots currently handed out
+    size_t live() const { std::lock_guard<std::mutex> guard(lock); return m_live; }
+};
+
+/**
+ * Standard allocator over Pool<T>::global(). std::allocate_shared rebinds it
+ * to its control block, so object and reference counts share one pooled slot.
+ */
+template<class T> struct PoolAllocator {
+    typedef T value_type;
+
+    PoolAllocator() {}
+    template<class U> PoolAllocator(const PoolAllocator<U>&) {}
+
+    T* allocate(size_t n) {
+        if(n != 1) return static_cast<T*>(::operator new(n * sizeof(T)));
+        return static_cast<T*>(Pool<T>::global().allocate());
+    }
+
+    void deallocate(T* p, size_t n) {
+        if(n != 1) ::operator delete(p);
+        else Pool<T>::global().deallocate(p);
+    }
+};
+
+template<class T, class U> inline bool operator==(const PoolAllocator<T>&, const PoolAllocator<U>&) { return true; }
+template<class T, class U> inline bool operator!=(const PoolAllocator<T>&, const PoolAllocator<U>&) { return false; }
+
+/// std::make_shared, but from a pool
+template<class T, class... Args> inline std::shared_ptr<T> pooled(Args&&... args) {
+    return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Args>(args)...);
+}
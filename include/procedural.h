@@ -1,8 +1,12 @@
 #pragma once
 #include <cstdint>
+#include <functional>
 
 namespace Procedural {
 
+    /// Bump whenever the output of any generator changes, this invalidates cached textures.
+    const uint32_t VERSION = 2;
+
     /**
      * This uses the hill algorithm defined here:
      * http://www.stuffwithstuff.com/robot-frog/3d/hills/hill.html
@@ -13,6 +17,30 @@ namespace Procedural {
      */
     uint8_t* generateHeightMap(uint32_t x, uint32_t y);
 
+    /// A rectangular piece of a height map, see generateHeightMapTiles
+    struct HeightTile {
+        /// Position of the tile's first texel in the whole map
+        uint32_t row;
+        uint32_t column;
+        /// Size of the tile
+        uint32_t rows;
+        uint32_t columns;
+        /// data[row][column] of just this tile, only valid during the callback
+        const uint8_t* data;
+    };
+
+    /**
+     * Produces the same map as generateHeightMap, but hands it out a tile at a
+     * time so maps of any size can be generated in bounded memory. The noise is
+     * evaluated twice, once to find its range and once to quantize it.
+     *
+     * @param x    width (number of columns)
+     * @param y    height (number of rows)
+     * @param sink Called once per tile, concurrently from the worker threads
+     * @param tile Width and height of the tiles
+     */
+    void generateHeightMapTiles(uint32_t x, uint32_t y, const std::function<void(const HeightTile&)>& sink, uint32_t tile = 256);
+
     /**
      * Creates alternating back/white grid.
      * If x and y are even, it is grid lines, and if odd a checkerboard pattern.
@@ -44,4 +72,27 @@ namespace Procedural {
      * @return           data[row][column][0=r, 1=g, 2=b, 3=a]
      */
     uint8_t* generateNormalMap(uint32_t x, uint32_t y, const uint8_t* height_map);
+
+    /**
+     * Halves a normal map by averaging each 2x2 block of normals and
+     * renormalizing, for building mip levels.
+     *
+     * @param x          width
+     * @param y          height
+     * @param normal_map data[row][column][0=r, 1=g, 2=b, 3=a]
+     * @return           A map of max(x/2, 1) by max(y/2, 1) in the same format
+     */
+    uint8_t* downsampleNormalMap(uint32_t x, uint32_t y, const uint8_t* normal_map);
+
+    /**
+     * Block compresses the x and y components of a normal map as RGTC2 (BC5).
+     * The z component is dropped, it can be recovered as sqrt(1 - x^2 - y^2)
+     * since every normal generated here faces out of the surface.
+     *
+     * @param x          width
+     * @param y          height
+     * @param normal_map data[row][column][0=r, 1=g, 2=b, 3=a]
+     * @return           16 bytes per 4x4 block of texels, blocks[row][column]
+     */
+    uint8_t* compressNormalMapRGTC(uint32_t x, uint32_t y, const uint8_t* normal_map);
 }
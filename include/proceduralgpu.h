@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QOpenGLFunctions_4_1_Core>
+#include <cstdint>
+
+#include "shader.h"
+
+/**
+ * Generates the same textures as Procedural, but by rendering into textures
+ * on the GPU so the texels never pass through the CPU. The results match the
+ * CPU versions within a few levels, the GPU does not round exactly the same.
+ *
+ * Needs a current context for its whole lifetime. The bound program,
+ * framebuffer, vertex array, texture and viewport are all restored afterwards,
+ * and temporary textures deleted, also when a pass throws.
+ */
+class ProceduralGPU {
+    QOpenGLFunctions_4_1_Core* gl;
+    Shader height_shader;
+    Shader range_shader;
+    Shader quantize_shader;
+    Shader normal_shader;
+    /// Empty, the full screen triangle is made from gl_VertexID
+    GLuint vao;
+    GLuint fbo;
+
+    /// Creates an uninitialized w by h texture with nearest filtering and no mipmaps
+    GLuint makeTexture(uint32_t w, uint32_t h, GLenum internal_format, GLenum format, GLenum type);
+    /// Runs shader over every texel of target, level 0
+    void draw(Shader& shader, GLuint target, uint32_t w, uint32_t h);
+    /// @return A 1x1 GL_RG32F texture holding the min and max of a GL_R32F texture
+    GLuint range(GLuint heights, uint32_t w, uint32_t h);
+
+public:
+    /// @throws ShaderException if the shaders fail to build
+    ProceduralGPU();
+    ~ProceduralGPU();
+
+    ProceduralGPU(const ProceduralGPU&) = delete;
+    ProceduralGPU& operator=(const ProceduralGPU&) = delete;
+
+    /**
+     * @see Procedural::generateHeightMap
+     * @param  x width (number of columns)
+     * @param  y height (number of rows)
+     * @return   A new GL_R8 texture, the caller owns it
+     */
+    GLuint generateHeightMap(uint32_t x, uint32_t y);
+
+    /**
+     * @see Procedural::generateNormalMap
+     * @param x          width (number of columns)
+     * @param y          height (number of rows)
+     * @param height_map A texture from generateHeightMap
+     * @return           A new GL_RG8 texture of the x and y of each normal, with a
+     *                   full mip chain, the caller owns it
+     */
+    GLuint generateNormalMap(uint32_t x, uint32_t y, GLuint height_map);
+
+    /**
+     * Generates both maps on the GPU and the CPU, then reads back and compares
+     * them. Prints the largest difference of each.
+     *
+     * @param x         width
+     * @param y         height
+     * @param tolerance The largest difference allowed, in 8 bit levels
+     * @return          true if both maps are within tolerance
+     */
+    bool verify(uint32_t x, uint32_t y, int tolerance = 2);
+};
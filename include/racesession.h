@@ -0,0 +1,85 @@
+#pragma once
+
+#include <QFileSystemWatcher>
+#include <QKeyEvent>
+#include <QMouseEvent>
+#include <QTimer>
+#include <memory>
+
+#include "framestats.h"
+#include "renderthread.h"
+#include "simulation.h"
+#include "world.h"
+
+/**
+ * The game behind a view, whichever kind of window hosts it: the world, its
+ * render and simulation threads, and the input handling. The host passes on
+ * its events and makes the RenderThread when it has a surface for one.
+ */
+class RaceSession {
+    unsigned tick_hz;
+    /// Frame rate caps while focused and while not, 0 for none, see setFrameCaps()
+    double focused_fps;
+    double background_fps;
+    bool focused;
+
+    float mouse_x;
+    float mouse_y;
+
+    /// Reloads the world when its scene file is saved
+    QFileSystemWatcher scene_watcher;
+    /// Editors often save in several steps, so reloads wait for them to settle
+    QTimer reload_timer;
+
+    void watchScene();
+
+public:
+    /// Frames a second while in the background, unless setFrameCaps() says otherwise
+    static constexpr double BACKGROUND_FPS = 10.0;
+
+    /// Only used on the render thread
+    Shader shader;
+    World world; // The car is in the world
+    /// Declared after world, so it stops before the world goes
+    std::unique_ptr<RenderThread> renderer;
+    /// Declared after renderer, so it stops publishing before the renderer goes
+    std::unique_ptr<Simulation> simulation;
+    /// Frames as the host presented them
+    FrameStats stats;
+
+    /// @param tick_hz Simulation ticks per second
+    explicit RaceSession(unsigned tick_hz = Simulation::DEFAULT_HZ);
+    /// Stops both threads
+    ~RaceSession();
+
+    RaceSession(const RaceSession&) = delete;
+    RaceSession& operator=(const RaceSession&) = delete;
+
+    /**
+     * Starts both threads, drawing through renderer, made with shader and
+     * world and not yet started.
+     * @param width  Of the view, in pixels
+     * @param height Of the view, in pixels
+     */
+    void start(RenderThread* renderer, int width, int height);
+    inline bool started() const { return renderer != nullptr; }
+
+    /**
+     * Limits the frame rate, 0 for as fast as the display goes. A hidden or
+     * minimised view draws nothing either way.
+     * @param focused While the view has keyboard focus
+     * @param background While it does not
+     */
+    void setFrameCaps(double focused, double background);
+    void setFocused(bool focused);
+
+    /// @return The Simulation::Keys flag of key
+    static int getKey(Qt::Key);
+
+    void keyPress(QKeyEvent*);
+    void keyRelease(QKeyEvent*);
+    void mousePress(QMouseEvent*);
+    void mouseMove(QMouseEvent*);
+    /// In pixels
+    void resize(int width, int height);
+};
@@ -1,49 +1,27 @@
 #pragma once
 
 #include <QOpenGLWidget>
+#include <chrono>
 
-#include "camera.h"
-#include "world.h"
+#include "racesession.h"
 
+/**
+ * Passes input on to the Simulation, which moves the car and cameras on its
+ * own thread and hands each tick to the RenderThread. paintGL() only copies
+ * the latest finished frame to the screen. See RaceWindow for the host
+ * without the copy.
+ */
 class RaceView : public QOpenGLWidget, protected QOpenGLFunctions_4_1_Core {
-    Shader shader;
-    World world; // The car is in the world
+    RaceSession session;
+    /// Reads the render thread's frames, framebuffers are not shared between contexts
+    GLuint read_fbo;
 
-    Camera chase;
-    Camera photo;
-    Camera observer;
-
-    float mouse_x;
-    float mouse_y;
-
-    void orientChase();
-    void orientPhoto();
-
-    void setLightUniforms(glm::mat4 view);
+    /// The image paintGL() last took up, recorded in the stats once it is swapped
+    std::chrono::steady_clock::time_point shown_input;
+    double shown_draw_ms;
+    bool shown_pending;
 
 protected:
-    enum CameraMode {
-        CHASE,
-        PHOTO,
-        OBSERVER
-    } camera_mode;
-
-    /// Flag enum to keep track of some specific keys
-    enum Keys {
-        KEYS_NONE  = 0x0000,
-        KEYS_W     = 0x0001,
-        KEYS_A     = 0x0002,
-        KEYS_S     = 0x0004,
-        KEYS_D     = 0x0008,
-        KEYS_Q     = 0x0010,
-        KEYS_E     = 0x0020,
-        KEYS_SPACE = 0x0040,
-        KEYS_SHIFT = 0x0080
-    };
-    int depressed_keys;
-
-    static int getKey(Qt::Key);
-
     virtual void initializeGL();
     virtual void resizeGL(int w, int h);
     virtual void paintGL();
@@ -51,11 +29,20 @@ protected:
     virtual void keyReleaseEvent(QKeyEvent*);
     virtual void mousePressEvent(QMouseEvent*);
     virtual void mouseMoveEvent(QMouseEvent*);
-    virtual void timerEvent(QTimerEvent*);
+    virtual void focusInEvent(QFocusEvent*);
+    virtual void focusOutEvent(QFocusEvent*);
 
     virtual QSize sizeHint() const { return QSize(800, 600); }
 
 public:
-    RaceView() : world("race.json", shader) { setFocusPolicy(Qt::FocusPolicy::StrongFocus); }
-    ~RaceView() {}
+    /// @param tick_hz Simulation ticks per second
+    explicit RaceView(unsigned tick_hz = Simulation::DEFAULT_HZ) :
+            session(tick_hz), read_fbo(0), shown_draw_ms(0.0), shown_pending(false) {
+        setFocusPolicy(Qt::FocusPolicy::StrongFocus);
+    }
+    ~RaceView();
+
+    /// See RaceSession::setFrameCaps()
+    inline void setFrameCaps(double focused, double background) { session.setFrameCaps(focused, background); }
+    inline const FrameStats& stats() const { return session.stats; }
 };
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <QWindow>
+
+#include "racesession.h"
+
+/**
+ * Hosts the game in a window of its own, which the RenderThread draws to
+ * and swaps directly, skipping RaceView's copy and Qt's composition. Wrap it
+ * in QWidget::createWindowContainer() to put it in a layout.
+ *
+ * Not a QOpenGLWindow, that paints on the GUI thread too.
+ */
+class RaceWindow : public QWindow {
+    RaceSession session;
+
+protected:
+    virtual void exposeEvent(QExposeEvent*);
+    virtual void resizeEvent(QResizeEvent*);
+    virtual void keyPressEvent(QKeyEvent*);
+    virtual void keyReleaseEvent(QKeyEvent*);
+    virtual void mousePressEvent(QMouseEvent*);
+    virtual void mouseMoveEvent(QMouseEvent*);
+    virtual void focusInEvent(QFocusEvent*);
+    virtual void focusOutEvent(QFocusEvent*);
+
+public:
+    /// @param tick_hz Simulation ticks per second
+    explicit RaceWindow(unsigned tick_hz = Simulation::DEFAULT_HZ);
+
+    /// See RaceSession::setFrameCaps()
+    inline void setFrameCaps(double focused, double background) { session.setFrameCaps(focused, background); }
+    inline const FrameStats& stats() const { return session.stats; }
+};
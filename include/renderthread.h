@@ -0,0 +1,174 @@
+#pragma once
+
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions_4_1_Core>
+#include <QOpenGLWidget>
+#include <QThread>
+#include <QWindow>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <condition_variable>
+#include <mutex>
+#include <glm/glm.hpp>
+
+#include "camera.h"
+#include "framestats.h"
+#include "triplebuffer.h"
+#include "world.h"
+
+/// What one simulation tick left behind
+struct FrameState {
+    /// The active camera
+    Camera camera;
+    /// The car is the only thing which moves, the rest of the world stays put
+    glm::mat4 car;
+};
+
+/**
+ * Everything the render thread needs from the simulation to draw one frame.
+ * Frames are drawn a tick behind, between previous and current, so motion
+ * stays smooth whatever the display rate, see RenderThread::draw().
+ */
+struct FrameSnapshot {
+    /// Counts up with each snapshot published
+    uint64_t serial;
+    FrameState previous;
+    FrameState current;
+    /// When the oldest input behind current arrived, the epoch for none, see FrameStats
+    std::chrono::steady_clock::time_point input;
+    /// The moment current stands for, on the steady clock
+    std::chrono::steady_clock::time_point time;
+    /// Simulated time between previous and current
+    std::chrono::steady_clock::duration tick;
+    int width;
+    int height;
+};
+
+/// A finished frame, the colour texture is shared with the widget's context
+struct FrameImage {
+    /// Only valid in the render thread's context, framebuffers are not shared
+    GLuint fbo;
+    GLuint texture;
+    GLuint depth;
+    int width;
+    int height;
+    /// Signalled once the render thread has drawn the image
+    GLsync written;
+    /// Signalled once the widget has copied the image out
+    GLsync read;
+    /// For FrameStats, from the snapshot drawn
+    std::chrono::steady_clock::time_point input;
+    double draw_ms;
+};
+
+/**
+ * Draws the world on a thread of its own, with its own context, so a slow
+ * frame no longer holds up input and other GUI events. The Simulation fills
+ * snapshots.back() and calls publish().
+ *
+ * Given a QWindow, the thread draws the newest snapshot straight to the
+ * window and swaps it itself. The swap waits for the display, which paces
+ * the frames.
+ *
+ * Given a QOpenGLWidget, which has to draw on the GUI thread, the render
+ * thread draws into images.back() with an offscreen surface, publishes it
+ * and asks the widget to update(). The widget's paintGL() copies
+ * images.front() to the screen, and once it has swapped calls
+ * requestFrame() for the next one. Both sides only wait on fences on the
+ * GPU, never on each other. Qt then composites the widget into its window,
+ * so this costs two extra full screen copies over a window.
+ *
+ * Frames are only drawn when they would differ from the last: a new
+ * snapshot, movement still being blended in, or a reload. While nothing
+ * changes the request just waits, so a parked car costs nothing.
+ *
+ * The World, but for the car, belongs to the render thread once start()ed:
+ * its meshes, shader and reload() all need the render thread's context.
+ */
+class RenderThread : public QThread {
+    /// One of the two is set
+    QOpenGLWidget* view;
+    QWindow* window;
+    World& world;
+    Shader& shader;
+    /// Frames presented to window, the widget records its own
+    FrameStats* stats;
+
+    QOpenGLContext* context;
+    QOffscreenSurface surface;
+    QOpenGLFunctions_4_1_Core* gl;
+
+    std::mutex lock;
+    std::condition_variable wake;
+    bool stopping;
+    bool reload_requested;
+    /// Set by requestFrame(), frames are only drawn when asked for
+    bool frame_requested;
+    /// Whether snapshots.front() holds anything yet
+    bool have_snapshot;
+    /**
+     * The last frame showed the newest snapshot at rest, and nothing changed
+     * since. Frames are skipped until something does, only on this thread.
+     */
+    bool settled;
+    /// Whether the window can be drawn to, see setExposed()
+    bool exposed;
+    /// The window was exposed again, so the last frame has to be drawn again
+    bool redraw_requested;
+    /// From setFrameCap(), 0 for no cap
+    std::atomic<int64_t> min_interval_ns;
+    std::atomic<uint64_t> drawn_serial;
+
+    void init(QOpenGLContext* share, const QSurfaceFormat& format);
+    /// Makes image width by height, keeping what it has if it is that size already
+    void resize(FrameImage& image, int width, int height);
+    /**
+     * Draws frame into the bound framebuffer, which is width by height.
+     * @return true if frame will look the same however much later it is drawn
+     */
+    bool draw(const FrameSnapshot& frame, int width, int height);
+    /// draw() into image, for the widget
+    bool drawImage(const FrameSnapshot& frame, FrameImage& image);
+    /// draw() to the window and swap
+    bool drawWindow(const FrameSnapshot& frame);
+
+protected:
+    virtual void run();
+
+public:
+    /// Written by one producer thread, see publish()
+    TripleBuffer<FrameSnapshot> snapshots;
+    /// Read by the widget's paintGL(), unused with a window
+    TripleBuffer<FrameImage> images;
+
+    /**
+     * Creates a context sharing with view's, call it on the GUI thread.
+     * @param shader Compiled and linked on the render thread
+     */
+    RenderThread(QOpenGLWidget* view, World& world, Shader& shader);
+    /**
+     * Creates a context to draw to window with, call it on the GUI thread
+     * once window has been created.
+     * @param stats Where presented frames are recorded
+     */
+    RenderThread(QWindow* window, World& world, Shader& shader, FrameStats& stats);
+    /// Stops the thread if it still runs
+    ~RenderThread();
+
+    /// Hands snapshots.back() to the render thread, from the thread which filled it
+    void publish();
+    /// Has the render thread draw a frame, call it each time the widget has swapped
+    void requestFrame();
+    /// Whether the window is on screen, nothing is drawn to it while not, from the GUI thread
+    void setExposed(bool exposed);
+    /// The serial of the last snapshot drawn, from any thread
+    inline uint64_t drawnSerial() const { return drawn_serial.load(); }
+    /// At most fps frames a second, 0 for as many as the display takes, from any thread
+    void setFrameCap(double fps);
+    /// Has the render thread reload() the world before its next frame
+    void requestReload();
+    /// Ends run() after the frame in progress, wait() for it after
+    void stop();
+};
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "mappedfile.h"
+
+/**
+ * The race data of a scene as flat arrays, one per property. The JSON a scene
+ * is written in is compiled into a binary file holding exactly these arrays,
+ * which World maps and reads in place, so loading does no parsing however
+ * many props the scene has.
+ *
+ * race.json stays the file to edit, World compiles it next to itself
+ * (race.json.scene) whenever it changes.
+ */
+namespace SceneFile {
+
+    /// Track::Track options, from "textures" and "verifyTextures" in the JSON
+    enum TrackFlags {
+        TRACK_GPU_TEXTURES = 1,
+        TRACK_VERIFY_TEXTURES = 2
+    };
+
+    /// Everything that is not a prop, each vector is 3 floats
+    struct Globals {
+        float bbox_min[3];
+        float bbox_max[3];
+        float start_position[3];
+        float start_pyr[3];
+        float photo_position[3];
+        float observer_position[3];
+        float sun_direction[3];
+        float sun_intensity[3];
+        float lamp_intensity[3];
+        uint32_t track_flags;
+    };
+
+    /// A whole scene, either pointing into a Scene or into a compiled file
+    struct View {
+        Globals globals;
+
+        uint32_t tree_count;
+        /// 3 floats per tree
+        const float* tree_positions;
+        const float* tree_heights;
+
+        uint32_t building_count;
+        /// 4 corners of 3 floats per building, counter-clockwise
+        const float* building_outlines;
+        /// 4 per building, the height above each corner
+        const float* building_heights;
+
+        uint32_t lamp_count;
+        /// 3 floats per lamp
+        const float* lamp_positions;
+        const float* lamp_heights;
+
+        /// Number of floats in each curb, 3 per point
+        uint32_t left_curb_count;
+        uint32_t right_curb_count;
+        const float* left_curb;
+        const float* right_curb;
+    };
+
+    /// A scene read from JSON, owning its arrays
+    struct Scene {
+        Globals globals;
+        std::vector<float> tree_positions;
+        std::vector<float> tree_heights;
+        std::vector<float> building_outlines;
+        std::vector<float> building_heights;
+        std::vector<float> lamp_positions;
+        std::vector<float> lamp_heights;
+        std::vector<float> left_curb;
+        std::vector<float> right_curb;
+
+        /// Only valid while this Scene is alive and unchanged
+        View view() const;
+        /// Copies the arrays of view
+        void assign(const View& view);
+    };
+
+    /**
+     * @throws std::invalid_argument if the track is missing or not numbers
+     * @return false if file_name can not be read
+     */
+    bool parseJson(const std::string& file_name, Scene& scene);
+
+    /// @return Where the compiled version of source is kept
+    std::string pathFor(const std::string& source);
+
+    /**
+     * Maps a compiled scene, the View points into file.
+     *
+     * @param source If not empty, the JSON the file must have been compiled
+     *               from, it is rejected once the JSON has changed
+     * @return       false if there is no such file, or it is stale or corrupt
+     */
+    bool load(const std::string& path, MappedFile& file, View& view,
+              const std::string& source = std::string());
+
+    /**
+     * @param source If not empty, the JSON the scene was parsed from
+     * @return false if the file could not be written
+     */
+    bool save(const std::string& path, const View& scene, const std::string& source = std::string());
+}
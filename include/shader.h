@@ -123,6 +123,14 @@ public:
 	/// <see>Shader::setUniform(const char*, const glm::vec4 & )</see>
 	void setUniform( const char * name, GLfloat val);
 
+	/// <summary>
+	/// Connects a uniform block to a buffer binding point (see glBindBufferBase).
+	/// </summary>
+	/// <param name="name">The name of the uniform block.  If this block does
+	///   not exist, the method does nothing.</param>
+	/// <param name="binding">The binding point</param>
+	void setUniformBlock( const char * name, GLuint binding);
+
 private:
 	std::string getFileContents( const std::string & fileName );
 	bool endsWith( const std::string &, const std::string & );
@@ -0,0 +1,196 @@
+#pragma once
+
+#include <QOpenGLFunctions_4_1_Core>
+#include <glm/glm.hpp>
+#include <vector>
+
+#include "meshdata.h"
+
+/**
+ * Unit sized geometry for the circular shapes, built by constexpr functions so
+ * the slice counts MeshMaker uses are tables in the binary rather than trig at
+ * startup. Any other slice count runs the very same functions at runtime, so
+ * both give bit for bit the same vertices.
+ *
+ * Positions have radius and height 1 and are scaled per mesh by scaled().
+ *   auto cone = ShapeGeometry::table<ShapeGeometry::ConeLayout, 16>.view();
+ */
+namespace ShapeGeometry {
+
+    namespace detail {
+        constexpr double HALF_PI = 1.57079632679489661923;
+
+        /// Taylor series, only accurate to a double for |x| <= pi / 2
+        constexpr void sincosSeries(double x, double& s, double& c) {
+            const double x2 = x * x;
+            double sterm = x, cterm = 1.0;
+            s = x;
+            c = 1.0;
+            for(int n = 1; n < 12; ++n) {
+                sterm *= -x2 / ((2 * n) * (2 * n + 1));
+                cterm *= -x2 / ((2 * n - 1) * (2 * n));
+                s += sterm;
+                c += cterm;
+            }
+        }
+
+        /// sin and cos of i / n turns, exact at every quarter turn
+        constexpr void sincosTurns(GLuint i, GLuint n, double& s, double& c) {
+            const GLuint quarter = (4 * i / n) % 4;
+            const GLuint rest = 4 * i % n;
+            double rs = 0.0, rc = 0.0;
+            sincosSeries(HALF_PI * rest / n, rs, rc);
+            switch(quarter) {
+                case 0:  s =  rs; c =  rc; break;
+                case 1:  s =  rc; c = -rs; break;
+                case 2:  s = -rs; c = -rc; break;
+                default: s = -rc; c =  rs; break;
+            }
+            // -0 + 0 is 0, so the tables have no negative zeros
+            s += 0.0;
+            c += 0.0;
+        }
+    }
+
+    /// Borrowed arrays of one shape, 3 floats per vertex in both
+    struct View {
+        const GLfloat* positions;
+        const GLfloat* normals;
+        GLuint vertices;
+        const GLuint* indices;
+        GLuint index_count;
+    };
+
+    /// The rim on z = 0 around a centre vertex, facing +z
+    struct DiskLayout {
+        static constexpr GLuint vertices(GLuint slices) { return slices + 1; }
+        static constexpr GLuint indices(GLuint slices) { return 3 * slices; }
+        static constexpr void generate(GLuint slices, GLfloat* positions, GLfloat* normals, GLuint* elements) {
+            for(GLuint x = 0; x < slices; ++x) {
+                double s = 0.0, c = 0.0;
+                detail::sincosTurns(x, slices, s, c);
+                positions[3 * x + 0] = (GLfloat)c;
+                positions[3 * x + 1] = (GLfloat)s;
+                positions[3 * x + 2] = 0.0f;
+                elements[3 * x + 0] = x;
+                elements[3 * x + 1] = (x + 1) % slices;
+                elements[3 * x + 2] = slices;
+            }
+            positions[3 * slices + 0] = 0.0f;
+            positions[3 * slices + 1] = 0.0f;
+            positions[3 * slices + 2] = 0.0f;
+            for(GLuint v = 0; v <= slices; ++v) {
+                normals[3 * v + 0] = 0.0f;
+                normals[3 * v + 1] = 0.0f;
+                normals[3 * v + 2] = 1.0f;
+            }
+        }
+    };
+
+    /**
+     * A rim vertex and an apex vertex per slice, the apex takes the normal
+     * of the middle of its slice.
+     *
+     * Normals are (cos, sin, 1) here, scaled by (h, h, r) / sqrt(h^2 + r^2)
+     * they point straight out of a cone of radius r and height h.
+     */
+    struct ConeLayout {
+        static constexpr GLuint vertices(GLuint slices) { return 2 * slices; }
+        static constexpr GLuint indices(GLuint slices) { return 3 * slices; }
+        static constexpr void generate(GLuint slices, GLfloat* positions, GLfloat* normals, GLuint* elements) {
+            for(GLuint x = 0; x < slices; ++x) {
+                double s0 = 0.0, c0 = 0.0, s1 = 0.0, c1 = 0.0;
+                detail::sincosTurns(2 * x, 2 * slices, s0, c0);
+                detail::sincosTurns(2 * x + 1, 2 * slices, s1, c1);
+                GLfloat* p = positions + 6 * x;
+                GLfloat* n = normals + 6 * x;
+                p[0] = (GLfloat)c0; p[1] = (GLfloat)s0; p[2] = 0.0f;
+                p[3] = 0.0f;        p[4] = 0.0f;        p[5] = 1.0f;
+                n[0] = (GLfloat)c0; n[1] = (GLfloat)s0; n[2] = 1.0f;
+                n[3] = (GLfloat)c1; n[4] = (GLfloat)s1; n[5] = 1.0f;
+
+                elements[3 * x + 0] = x * 2;
+                elements[3 * x + 1] = ((x + 1) % slices) * 2;
+                elements[3 * x + 2] = x * 2 + 1;
+            }
+        }
+    };
+
+    /// A top (z = 1) and bottom (z = 0) vertex per slice, no caps
+    struct CylinderLayout {
+        static constexpr GLuint vertices(GLuint slices) { return 2 * slices; }
+        static constexpr GLuint indices(GLuint slices) { return 6 * slices; }
+        static constexpr void generate(GLuint slices, GLfloat* positions, GLfloat* normals, GLuint* elements) {
+            for(GLuint x = 0; x < slices; ++x) {
+                double s = 0.0, c = 0.0;
+                detail::sincosTurns(x, slices, s, c);
+                GLfloat* p = positions + 6 * x;
+                GLfloat* n = normals + 6 * x;
+                p[0] = (GLfloat)c; p[1] = (GLfloat)s; p[2] = 1.0f;
+                p[3] = (GLfloat)c; p[4] = (GLfloat)s; p[5] = 0.0f;
+                n[0] = (GLfloat)c; n[1] = (GLfloat)s; n[2] = 0.0f;
+                n[3] = (GLfloat)c; n[4] = (GLfloat)s; n[5] = 0.0f;
+
+                GLuint s0 = x * 2;
+                GLuint s1 = ((x + 1) % slices) * 2; // 0——2 ...
+                GLuint* e = elements + 6 * x;       // |  |
+                e[0] = s0;     e[1] = s0 + 1; e[2] = s1 + 1;
+                e[3] = s1 + 1; e[4] = s1;     e[5] = s0; // 1——3 ...
+            }
+        }
+    };
+
+    /// The arrays of a Layout for a fixed number of slices
+    template<class Layout, GLuint Slices> struct Table {
+        static constexpr GLuint VERTICES = Layout::vertices(Slices);
+        static constexpr GLuint INDICES = Layout::indices(Slices);
+
+        GLfloat positions[3 * VERTICES];
+        GLfloat normals[3 * VERTICES];
+        GLuint indices[INDICES];
+
+        View view() const { View v = { positions, normals, VERTICES, indices, INDICES }; return v; }
+    };
+
+    template<class Layout, GLuint Slices> constexpr Table<Layout, Slices> makeTable() {
+        Table<Layout, Slices> t{};
+        Layout::generate(Slices, t.positions, t.normals, t.indices);
+        return t;
+    }
+
+    /// Evaluated by the compiler, one copy in .rodata per translation unit using it
+    template<class Layout, GLuint Slices> constexpr Table<Layout, Slices> table = makeTable<Layout, Slices>();
+
+    template<GLuint Slices> using DiskGeometry = Table<DiskLayout, Slices>;
+    template<GLuint Slices> using ConeGeometry = Table<ConeLayout, Slices>;
+    template<GLuint Slices> using CylinderGeometry = Table<CylinderLayout, Slices>;
+
+    /// Owns the arrays of a slice count that has no table
+    struct Storage {
+        std::vector<GLfloat> positions;
+        std::vector<GLfloat> normals;
+        std::vector<GLuint> indices;
+    };
+
+    /**
+     * @param storage Only used when there is no table for slices, must outlive the View
+     * @return The table for the slice counts MeshMaker uses (8 and 16), otherwise
+     * the same arrays generated at runtime
+     */
+    template<class Layout> View lookup(GLuint slices, Storage& storage) {
+        switch(slices) {
+            case 8:  return table<Layout, 8>.view();
+            case 16: return table<Layout, 16>.view();
+        }
+        storage.positions.resize(3 * Layout::vertices(slices));
+        storage.normals.resize(3 * Layout::vertices(slices));
+        storage.indices.resize(Layout::indices(slices));
+        Layout::generate(slices, storage.positions.data(), storage.normals.data(), storage.indices.data());
+        View v = { storage.positions.data(), storage.normals.data(), Layout::vertices(slices),
+                   storage.indices.data(), Layout::indices(slices) };
+        return v;
+    }
+
+    /// Copies a View into MeshData, allocating each array once at its final size
+    MeshData scaled(const View& view, glm::vec3 position_scale, glm::vec3 normal_scale = glm::vec3(1.0f));
+}
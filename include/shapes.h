@@ -1,9 +1,9 @@
 #pragma once
 
-#include <QJsonObject>
 #include <glm/glm.hpp>
 
 #include "mesh.h"
+#include "texcache.h"
 
 struct Circular {
 protected:
@@ -26,7 +26,7 @@ public:
     Cube(GLfloat side) : m_side(side) {}
     virtual ~Cube() {}
     GLfloat getSide() { return m_side; }
-    virtual void init();
+    virtual MeshData build() const;
 };
 
 
@@ -34,18 +34,17 @@ class Disk : public TriangleMesh, public Circular {
 public:
     Disk(GLfloat r, GLuint s) : Circular(r, s) {}
     virtual ~Disk() {}
-    virtual void init();
+    virtual MeshData build() const;
 };
 
 
 class Cone : public TriangleMesh, public Circular {
     GLfloat m_height;
-    glm::vec3 calculateNormal(GLfloat sin, GLfloat cos);
 public:
     Cone(GLfloat r, GLfloat h, GLuint s) : Circular(r, s), m_height(h) {}
     virtual ~Cone() {}
     virtual GLfloat getHeight() { return m_height; }
-    virtual void init();
+    virtual MeshData build() const;
 };
 
 
@@ -55,7 +54,7 @@ public:
     Cylinder(GLfloat r, GLfloat h, GLuint s) : Circular(r, s), m_height(h) {}
     virtual ~Cylinder() {}
     virtual GLfloat getHeight() { return m_height; }
-    virtual void init();
+    virtual MeshData build() const;
 };
 
 
@@ -67,7 +66,7 @@ public:
     /// @param p An array of the four mesh corners
 	Quad(glm::vec3 p[4]) { setPosition(p); }
     virtual ~Quad() {}
-    virtual void init();
+    virtual MeshData build() const;
 
     /// @param np An array of the four new mesh corners
 	virtual inline void setPosition(glm::vec3 np[4]) {
@@ -82,10 +81,29 @@ class Track : public TriangleMesh {
     std::vector<GLfloat> right_curb;
     /// Normal map texture id
     GLuint normal_map_id;
+    /// Generate the normal map on the GPU rather than the CPU (or the cache)
+    bool gpu_textures;
+    /// Compare the GPU normal map against the CPU one when it is generated
+    bool verify_textures;
+
+    /// Built by prepare(), released once uploaded
+    TextureCache::Image normal_map;
+
+    /// Loads the normal map from the cache, or generates it on the CPU
+    void buildNormalMap();
 
 public:
-    Track(QJsonObject a);
-    virtual ~Track() {}
+    /**
+     * @param left  3 floats per point of the left curb, left_count floats
+     * @param right The right curb, each point matching one of the left
+     */
+    Track(const GLfloat* left, size_t left_count, const GLfloat* right, size_t right_count,
+          bool gpu_textures, bool verify_textures);
+    /// Deletes the normal map, reload() replaces the track whenever the curbs change
+    virtual ~Track();
+    virtual MeshData build() const;
+    /// Also loads or generates the normal map, unless it is generated on the GPU
+    virtual void prepare();
     virtual void init();
     virtual void setUniform(Shader& ) {
         QOpenGLFunctions_4_1_Core* gl =
@@ -104,9 +122,9 @@ class Building : public TriangleMesh {
 	float height[4];
 
     void buildFace(std::vector<GLfloat>& pts, std::vector<GLfloat>& norm,
-		std::vector<GLuint>& el, int idx1, int idx2);
+		std::vector<GLuint>& el, int idx1, int idx2) const;
 	void buildTopTri(std::vector<GLfloat>& pts, std::vector<GLfloat>& norm,
-		std::vector<GLuint>& el, int idx1, int idx2, int idx3);
+		std::vector<GLuint>& el, int idx1, int idx2, int idx3) const;
 
 public:
     /**
@@ -117,7 +135,7 @@ public:
      */
     Building(glm::vec3 b[4], float h[4]);
     virtual ~Building() {}
-    virtual void init();
+    virtual MeshData build() const;
 };
 
 
@@ -144,5 +162,13 @@ public:
         if(colors != nullptr)    delete colors;
         if(texcoords != nullptr) delete texcoords;
     }
-    virtual void init() { TriangleMesh::init(tris, points, normals, colors, texcoords); }
+    virtual MeshData build() const {
+        MeshData data;
+        if(tris != nullptr)      data.indices = *tris;
+        if(points != nullptr)    data.positions = *points;
+        if(normals != nullptr)   data.normals = *normals;
+        if(colors != nullptr)    data.colors = *colors;
+        if(texcoords != nullptr) data.texcoords = *texcoords;
+        return data;
+    }
 };
@@ -0,0 +1,197 @@
+#pragma once
+
+/**
+ * Simplex noise over packs of floats, one texel per lane. This mirrors
+ * glm::simplex operation for operation so every lane rounds the same way the
+ * scalar version does.
+ *
+ * This is only meant to be included by the per instruction set kernels. Before
+ * including it define NOISE_TARGET (function attributes, usually empty) and a
+ * pack type V providing:
+ *   V(float) broadcast, + - * / operators, V::WIDTH,
+ *   vfloor, vabs, vmin, vmax, and vge/vgt returning 1.0 or 0.0 per lane.
+ *
+ * Everything is in an unnamed namespace, so each includer gets its own copy
+ * compiled for its own target.
+ */
+#ifndef NOISE_TARGET
+#error "Define NOISE_TARGET before including simplexkernel.h"
+#endif
+
+#include <cstdint>
+
+namespace {
+
+    template<class V> NOISE_TARGET inline V mod289(V x) {
+        return x - vfloor(x * V(1.0f / 289.0f)) * V(289.0f);
+    }
+
+    template<class V> NOISE_TARGET inline V permute(V x) {
+        return mod289(((x * V(34.0f)) + V(1.0f)) * x);
+    }
+
+    template<class V> NOISE_TARGET inline V taylorInvSqrt(V r) {
+        return V(1.79284291400159f) - V(0.85373472095314f) * r;
+    }
+
+    /// glm::simplex(glm::vec2(x, y))
+    template<class V> NOISE_TARGET V simplex(V vx, V vy) {
+        const V Cx( 0.211324865405187f); // (3.0 -  sqrt(3.0)) / 6.0
+        const V Cy( 0.366025403784439f); //  0.5 * (sqrt(3.0)  - 1.0)
+        const V Cz(-0.577350269189626f); // -1.0 + 2.0 * C.x
+        const V Cw( 0.024390243902439f); //  1.0 / 41.0
+        const V zero(0.0f), one(1.0f), half(0.5f);
+
+        // First corner
+        const V d0 = vx * Cy + vy * Cy;
+        V ix = vfloor(vx + d0);
+        V iy = vfloor(vy + d0);
+        const V d1 = ix * Cx + iy * Cx;
+        const V x0x = vx - ix + d1;
+        const V x0y = vy - iy + d1;
+
+        // Other corners
+        const V i1x = vgt(x0x, x0y);
+        const V i1y = one - i1x;
+        const V x1x = x0x + Cx - i1x;
+        const V x1y = x0y + Cx - i1y;
+        const V x2x = x0x + Cz;
+        const V x2y = x0y + Cz;
+
+        // Permutations, glm::mod divides rather than multiplying by the reciprocal
+        ix = ix - V(289.0f) * vfloor(ix / V(289.0f));
+        iy = iy - V(289.0f) * vfloor(iy / V(289.0f));
+        const V p0 = permute(permute(iy + zero) + ix + zero);
+        const V p1 = permute(permute(iy + i1y)  + ix + i1x);
+        const V p2 = permute(permute(iy + one)  + ix + one);
+
+        V m0 = vmax(half - (x0x * x0x + x0y * x0y), zero);
+        V m1 = vmax(half - (x1x * x1x + x1y * x1y), zero);
+        V m2 = vmax(half - (x2x * x2x + x2y * x2y), zero);
+        m0 = m0 * m0; m1 = m1 * m1; m2 = m2 * m2;
+        m0 = m0 * m0; m1 = m1 * m1; m2 = m2 * m2;
+
+        // Gradients: 41 points uniformly over a line, mapped onto a diamond.
+        const V x_0 = V(2.0f) * (p0 * Cw - vfloor(p0 * Cw)) - one;
+        const V x_1 = V(2.0f) * (p1 * Cw - vfloor(p1 * Cw)) - one;
+        const V x_2 = V(2.0f) * (p2 * Cw - vfloor(p2 * Cw)) - one;
+        const V h0 = vabs(x_0) - half;
+        const V h1 = vabs(x_1) - half;
+        const V h2 = vabs(x_2) - half;
+        const V a0 = x_0 - vfloor(x_0 + half);
+        const V a1 = x_1 - vfloor(x_1 + half);
+        const V a2 = x_2 - vfloor(x_2 + half);
+
+        // Normalise gradients implicitly by scaling m
+        m0 = m0 * taylorInvSqrt(a0 * a0 + h0 * h0);
+        m1 = m1 * taylorInvSqrt(a1 * a1 + h1 * h1);
+        m2 = m2 * taylorInvSqrt(a2 * a2 + h2 * h2);
+
+        const V g0 = a0 * x0x + h0 * x0y;
+        const V g1 = a1 * x1x + h1 * x1y;
+        const V g2 = a2 * x2x + h2 * x2y;
+        return V(130.0f) * (m0 * g0 + m1 * g1 + m2 * g2);
+    }
+
+    /// One corner of the 3D simplex, returns the corner's contribution before the final scale
+    template<class V> NOISE_TARGET inline V corner3(V p, V x, V y, V z, V& m) {
+        const V n_(0.142857142857f); // 1.0/7.0
+        const V nsx = n_ * V(2.0f);
+        const V nsy = n_ * V(0.5f) - V(1.0f);
+        const V nsz = n_;
+
+        // Gradients: 7x7 points over a square, mapped onto an octahedron.
+        const V j = p - V(49.0f) * vfloor(p * nsz * nsz);
+        const V gx_ = vfloor(j * nsz);
+        const V gy_ = vfloor(j - V(7.0f) * gx_);
+        const V gx = gx_ * nsx + nsy;
+        const V gy = gy_ * nsx + nsy;
+        const V h = V(1.0f) - vabs(gx) - vabs(gy);
+
+        const V sh = V(0.0f) - (V(1.0f) - vgt(h, V(0.0f)));
+        V px = gx + (vfloor(gx) * V(2.0f) + V(1.0f)) * sh;
+        V py = gy + (vfloor(gy) * V(2.0f) + V(1.0f)) * sh;
+        V pz = h;
+
+        const V norm = taylorInvSqrt(px * px + py * py + pz * pz);
+        px = px * norm; py = py * norm; pz = pz * norm;
+
+        m = vmax(V(0.6f) - (x * x + y * y + z * z), V(0.0f));
+        m = m * m;
+        return px * x + py * y + pz * z;
+    }
+
+    /// glm::simplex(glm::vec3(x, y, z))
+    template<class V> NOISE_TARGET V simplex(V vx, V vy, V vz) {
+        const V Cx(1.0f / 6.0f), Cy(1.0f / 3.0f);
+        const V one(1.0f);
+
+        // First corner
+        const V d0 = vx * Cy + vy * Cy + vz * Cy;
+        V ix = vfloor(vx + d0);
+        V iy = vfloor(vy + d0);
+        V iz = vfloor(vz + d0);
+        const V d1 = ix * Cx + iy * Cx + iz * Cx;
+        const V x0x = vx - ix + d1;
+        const V x0y = vy - iy + d1;
+        const V x0z = vz - iz + d1;
+
+        // Other corners
+        const V gx = vge(x0x, x0y);
+        const V gy = vge(x0y, x0z);
+        const V gz = vge(x0z, x0x);
+        const V lx = one - gx, ly = one - gy, lz = one - gz;
+        const V i1x = vmin(gx, lz), i1y = vmin(gy, lx), i1z = vmin(gz, ly);
+        const V i2x = vmax(gx, lz), i2y = vmax(gy, lx), i2z = vmax(gz, ly);
+
+        const V x1x = x0x - i1x + Cx, x1y = x0y - i1y + Cx, x1z = x0z - i1z + Cx;
+        const V x2x = x0x - i2x + Cy, x2y = x0y - i2y + Cy, x2z = x0z - i2z + Cy;
+        const V x3x = x0x - V(0.5f),  x3y = x0y - V(0.5f),  x3z = x0z - V(0.5f);
+
+        // Permutations
+        ix = mod289(ix); iy = mod289(iy); iz = mod289(iz);
+        const V p0 = permute(permute(permute(iz + V(0.0f)) + iy + V(0.0f)) + ix + V(0.0f));
+        const V p1 = permute(permute(permute(iz + i1z) + iy + i1y) + ix + i1x);
+        const V p2 = permute(permute(permute(iz + i2z) + iy + i2y) + ix + i2x);
+        const V p3 = permute(permute(permute(iz + one) + iy + one) + ix + one);
+
+        V m0(0.0f), m1(0.0f), m2(0.0f), m3(0.0f);
+        const V d_0 = corner3(p0, x0x, x0y, x0z, m0);
+        const V d_1 = corner3(p1, x1x, x1y, x1z, m1);
+        const V d_2 = corner3(p2, x2x, x2y, x2z, m2);
+        const V d_3 = corner3(p3, x3x, x3y, x3z, m3);
+
+        // glm sums a vec4 dot product pairwise
+        return V(42.0f) * ((m0 * m0 * d_0 + m1 * m1 * d_1) + (m2 * m2 * d_2 + m3 * m3 * d_3));
+    }
+
+    /// The octaves used by Procedural::generateHeightMap, see HeightKernel::RowFunction
+    template<class V> NOISE_TARGET void heightOctaves(uint32_t row, uint32_t column, uint32_t n, float* out) {
+        const uint32_t W = V::WIDTH;
+        alignas(32) float ys[W];
+        alignas(32) float zs[W];
+        alignas(32) float result[W];
+
+        const V x((float)row);
+        for(uint32_t done = 0; done < n; done += W) {
+            // The last pack repeats the final texel in its unused lanes
+            for(uint32_t l = 0; l < W; ++l) {
+                uint32_t y = column + done + ((done + l < n) ? l : n - 1 - done);
+                ys[l] = (float)y;
+                zs[l] = (float)(row * y) / 10.0f;
+            }
+            const V y = V::load(ys);
+            const V z = V::load(zs);
+
+            V i(0.0f);
+            i = i + simplex(x / V(8.0f), y / V(8.0f)) / V(4.0f);
+            i = i + simplex(x / V(4.0f), y / V(4.0f)) / V(2.0f);
+            i = i + simplex(x / V(2.0f), y / V(2.0f));
+            i = i + simplex(x * V(2.0f), y * V(2.0f), z) * V(4.0f);
+            i.store(result);
+
+            for(uint32_t l = 0; l < W && done + l < n; ++l)
+                out[done + l] = result[l];
+        }
+    }
+}
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#include "camera.h"
+#include "renderthread.h"
+#include "spscring.h"
+#include "world.h"
+
+/**
+ * Drives the car and the cameras on a thread of its own, in fixed steps
+ * independent of the GUI's timers and the display.
+ *
+ * The GUI thread only queues input with send(). Real time elapsed is added
+ * up and spent in steps of exactly one tick, each applying whatever input
+ * arrived since the last, so the result does not depend on how punctually
+ * the thread wakes. After stepping the last two states go to the
+ * RenderThread as a FrameSnapshot, which draws between them at whatever
+ * rate the display runs. Ticks which change nothing are not sent. Input
+ * takes effect at most one tick after it happened.
+ *
+ * The car belongs to this thread once start()ed.
+ */
+class Simulation {
+public:
+    static const unsigned DEFAULT_HZ = 240;
+
+    enum CameraMode {
+        CHASE,
+        PHOTO,
+        OBSERVER
+    };
+
+    /// Flag enum to keep track of some specific keys
+    enum Keys {
+        KEYS_NONE  = 0x0000,
+        KEYS_W     = 0x0001,
+        KEYS_A     = 0x0002,
+        KEYS_S     = 0x0004,
+        KEYS_D     = 0x0008,
+        KEYS_Q     = 0x0010,
+        KEYS_E     = 0x0020,
+        KEYS_SPACE = 0x0040,
+        KEYS_SHIFT = 0x0080
+    };
+
+    struct Input {
+        enum Type {
+            KEY_DOWN,
+            KEY_UP,
+            /// value is the CameraMode
+            CAMERA,
+            /// x and y are how far the mouse moved, in pixels
+            LOOK,
+            /// x and y are the new size of the view
+            RESIZE
+        } type;
+        /// The Keys flag, or the CameraMode
+        int value;
+        float x;
+        float y;
+        /// When send() queued it
+        std::chrono::steady_clock::time_point time;
+    };
+
+    /// Units per second
+    static constexpr float CAR_SPEED = 30.0f;
+    /// Radians per second
+    static constexpr float CAR_TURN = 3.0f;
+    /// Units per second
+    static constexpr float OBSERVER_SPEED = 30.0f;
+    /// Ticks run at most per wake up, time beyond that after a stall is dropped
+    static const unsigned MAX_CATCH_UP = 8;
+
+    /// @param hz Ticks per second
+    Simulation(World& world, RenderThread& renderer, unsigned hz = DEFAULT_HZ);
+    /// Stops the thread
+    ~Simulation();
+
+    Simulation(const Simulation&) = delete;
+    Simulation& operator=(const Simulation&) = delete;
+
+    void start();
+    void stop();
+
+    /// Queues input for the next tick, from the GUI thread
+    void send(Input::Type type, int value = 0, float x = 0.0f, float y = 0.0f);
+
+    inline unsigned tickRate() const { return hz; }
+
+private:
+    World& world;
+    RenderThread& renderer;
+    unsigned hz;
+
+    std::thread thread;
+    std::atomic<bool> stopping;
+    /// Generous, a tick takes what arrived since the last one
+    SpscRing<Input, 256> inputs;
+
+    CameraMode camera_mode;
+    int depressed_keys;
+    int width;
+    int height;
+
+    Camera chase;
+    Camera photo;
+    Camera observer;
+
+    /// The last two ticks, what publish() sends
+    FrameState previous;
+    FrameState current;
+
+    uint64_t serial;
+    /**
+     * The oldest input which changed something and has not been drawn yet.
+     * Sent with every snapshot from input_serial on, until the renderer has
+     * drawn one of them, as it only draws the newest.
+     */
+    std::chrono::steady_clock::time_point input;
+    uint64_t input_serial;
+
+    void run();
+    /**
+     * Advances everything by dt seconds.
+     * @return false if the tick left everything as it was
+     */
+    bool tick(float dt);
+    /// @return false if in left everything as it was, e.g. a look outside OBSERVER
+    bool apply(const Input& in);
+    /// Sends previous and current, current standing for time
+    void publish(std::chrono::steady_clock::time_point time, std::chrono::steady_clock::duration tick);
+
+    void orientChase();
+    void orientPhoto();
+};
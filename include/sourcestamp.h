@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * Identifies the contents of a source file that something was built from, so
+ * a cache can tell whether it is stale. Plain data, it is stored as is in the
+ * headers of the cache files.
+ */
+struct SourceStamp {
+    uint64_t size;
+    int64_t  mtime;
+    uint64_t hash;
+
+    /// @return false if source can not be read
+    static bool of(const std::string& source, SourceStamp& stamp);
+
+    /**
+     * The same size and time count as a match without reading the source.
+     * Only a file of the same size with a new time, e.g. touched or checked
+     * out again, is hashed to tell whether it really changed.
+     */
+    bool matches(const std::string& source) const;
+
+    /// FNV-1a over 8 bytes at a time, over the whole source
+    static uint64_t hashBytes(const uint8_t* data, size_t len);
+};
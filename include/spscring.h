@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+/**
+ * A fixed size queue between one producer thread and one consumer thread,
+ * without locks. push() fails rather than waits when the ring is full.
+ *
+ * @tparam N Capacity, a power of two
+ */
+template<class T, size_t N> class SpscRing {
+    static_assert(N != 0 && (N & (N - 1)) == 0, "SpscRing capacity must be a power of two");
+
+    T items[N];
+    /// Next slot to read, only the consumer moves it
+    std::atomic<size_t> head;
+    /// Next slot to write, only the producer moves it
+    std::atomic<size_t> tail;
+
+public:
+    SpscRing() : items(), head(0), tail(0) {}
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    /// From the producer. @return false if the ring is full, item is dropped
+    bool push(const T& item) {
+        const size_t t = tail.load(std::memory_order_relaxed);
+        if(t - head.load(std::memory_order_acquire) == N) return false;
+        items[t & (N - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /// From the consumer. @return false if the ring is empty
+    bool pop(T& item) {
+        const size_t h = head.load(std::memory_order_relaxed);
+        if(h == tail.load(std::memory_order_acquire)) return false;
+        item = items[h & (N - 1)];
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+};
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <QOpenGLFunctions_4_1_Core>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * Persists generated textures to disk so they only have to be generated once.
+ * Each entry is keyed by a hash of the parameters that were used to generate
+ * it, so changing the generator (or its inputs) simply results in a miss.
+ */
+namespace TextureCache {
+
+    /// A texture and its full mip chain, level 0 first.
+    struct Image {
+        uint32_t width;
+        uint32_t height;
+        /// Width and height of a block of texels, 1 unless block compressed
+        uint32_t block_size;
+        /// Number of bytes per block
+        uint32_t block_bytes;
+        /// OpenGL internal format of every level
+        GLenum internal_format;
+        /// OpenGL pixel format of every level, 0 if block compressed
+        GLenum format;
+        std::vector< std::vector<uint8_t> > levels;
+
+        Image() : width(0), height(0), block_size(1), block_bytes(0), internal_format(0), format(0) {}
+
+        inline bool isCompressed() const { return format == 0; }
+
+        /// @return Size in bytes of the given mip level
+        size_t levelSize(uint32_t level) const;
+    };
+
+    /**
+     * Builds a key for a generated texture.
+     *
+     * @param generator Name of the generator, e.g. "track_normal"
+     * @param version   Bumped whenever the generator's output changes
+     * @param x         width
+     * @param y         height
+     */
+    uint64_t makeKey(const std::string& generator, uint32_t version, uint32_t x, uint32_t y);
+
+    /**
+     * Fills the remaining mip levels from level 0 of img.
+     *
+     * @param img        Must contain exactly one level
+     * @param downsample Returns a new[] buffer of size (x/2)*(y/2) (min 1) texels
+     */
+    void buildMipChain(Image& img, uint8_t* (*downsample)(uint32_t x, uint32_t y, const uint8_t* data));
+
+    /**
+     * Re-encodes every level of an uncompressed image, e.g. to block compress it.
+     *
+     * @param img             The image to convert
+     * @param internal_format The new internal format
+     * @param format          The new pixel format, 0 if block compressed
+     * @param block_size      The new block width and height
+     * @param block_bytes     The new number of bytes per block
+     * @param encode          Returns a new[] buffer of the converted level
+     */
+    void encode(Image& img, GLenum internal_format, GLenum format, uint32_t block_size,
+                uint32_t block_bytes, uint8_t* (*encode)(uint32_t x, uint32_t y, const uint8_t* data));
+
+    /**
+     * @param file_name Path of the cache file
+     * @param key       Must match the key the file was saved with
+     * @param img       Output, only modified on success
+     * @return          false if the file is missing, stale or corrupt
+     */
+    bool load(const std::string& file_name, uint64_t key, Image& img);
+
+    /// @return false if the file could not be written
+    bool save(const std::string& file_name, uint64_t key, const Image& img);
+
+    /**
+     * Uploads every level of img to the texture currently bound to GL_TEXTURE_2D
+     * and sets up trilinear filtering.
+     */
+    void upload(QOpenGLFunctions_4_1_Core* gl, const Image& img);
+}
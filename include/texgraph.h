@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * A graph of procedural texture operations. Nodes only describe the work, a
+ * Graph evaluates them tile by tile on the ThreadPool and remembers each
+ * result by a hash of the node, its parameters and all of its inputs. Surfaces
+ * built from the same pieces share them rather than generating them again.
+ *
+ * The track's normal map, exactly as Procedural generates it:
+ *   auto heights = TexGraph::remap(TexGraph::noise(), 0.0f, 1.0f, 256);
+ *   auto normals = TexGraph::pack(TexGraph::deriveNormal(heights), TexGraph::SIGNED);
+ *   auto image = TexGraph::Graph::shared().evaluate(normals, 512, 512);
+ */
+namespace TexGraph {
+
+    enum Type { FLOAT, UINT8 };
+
+    /// How pack() turns floats into bytes
+    enum Encoding {
+        /// [-1, 1] to [0, 255], truncated like Procedural::generateNormalMap
+        SIGNED,
+        /// [0, 1] to [0, 255], rounded
+        UNORM
+    };
+
+    /// Texels stored data[row][column][channel]
+    struct Image {
+        uint32_t width;
+        uint32_t height;
+        uint32_t channels;
+        Type type;
+        /// Aligned to BufferPool::ALIGNMENT, returned to the pool once released
+        std::shared_ptr<uint8_t> data;
+
+        Image() : width(0), height(0), channels(0), type(FLOAT) {}
+
+        inline size_t texels() const { return (size_t)width * height; }
+        inline size_t bytes() const { return texels() * channels * (type == FLOAT ? sizeof(float) : 1); }
+
+        inline float* floats() const { return reinterpret_cast<float*>(data.get()); }
+        inline uint8_t* uints() const { return data.get(); }
+    };
+
+    /// Recycles image storage, so evaluating a graph again does not hit the allocator
+    class BufferPool {
+        struct State;
+        std::shared_ptr<State> state;
+
+    public:
+        static const size_t ALIGNMENT = 64;
+
+        BufferPool();
+
+        /// The pool used by every Graph
+        static BufferPool& global();
+
+        /// @return At least bytes of storage which goes back to the pool once released
+        std::shared_ptr<uint8_t> acquire(size_t bytes);
+
+        /// Frees every buffer not currently in use
+        void trim();
+
+        /// Number of requests which needed a new allocation
+        size_t allocations() const;
+        /// Number of requests served from a released buffer
+        size_t reuses() const;
+    };
+
+    /// A rectangle of texels, see forEachTile
+    struct Tile {
+        uint32_t row;
+        uint32_t column;
+        uint32_t rows;
+        uint32_t columns;
+    };
+
+    /// Calls fn for every tile of a w by h image, concurrently on the ThreadPool
+    void forEachTile(uint32_t w, uint32_t h, const std::function<void(const Tile&)>& fn);
+
+    class Node;
+    typedef std::shared_ptr<const Node> NodePtr;
+
+    /// One operation, its inputs are always evaluated at the same size as it is
+    class Node {
+        std::vector<NodePtr> m_inputs;
+        uint64_t m_key;
+
+    protected:
+        /// @param name Unique per type of node, it seeds the key
+        Node(const char* name, std::vector<NodePtr> inputs);
+
+        /// Adds a parameter to the key, call it from the constructor for every parameter
+        void mix(const void* data, size_t size);
+        template<class T> inline void mix(const T& value) { mix(&value, sizeof(value)); }
+
+    public:
+        virtual ~Node() {}
+
+        inline const std::vector<NodePtr>& inputs() const { return m_inputs; }
+        /// Identifies the result of this node
+        inline uint64_t key() const { return m_key; }
+
+        virtual uint32_t channels() const = 0;
+        virtual Type type() const { return FLOAT; }
+
+        /**
+         * @param in  The evaluated inputs, in order
+         * @param out Allocated to the size of the inputs, fill it in
+         */
+        virtual void run(const std::vector<const Image*>& in, Image& out) const = 0;
+    };
+
+    /// The hill noise used by Procedural::generateHeightMap, not yet normalized
+    NodePtr noise();
+
+    /// @return a * weight_a + b * weight_b, both must have the same number of channels
+    NodePtr combine(NodePtr a, NodePtr b, float weight_a = 1.0f, float weight_b = 1.0f);
+
+    /**
+     * Stretches the range of a single channel image to [low, high].
+     *
+     * @param levels Quantizes the normalized value to this many levels first, as
+     *               Procedural::generateHeightMap does with 256. 0 to leave it be.
+     */
+    NodePtr remap(NodePtr in, float low, float high, uint32_t levels = 0);
+
+    /// Unit normals from a single channel height map, the edges wrap like Procedural::generateNormalMap
+    NodePtr deriveNormal(NodePtr heights);
+
+    /// Converts 1 (grey), 3 or 4 channels to RGBA bytes, alpha is 255 unless given
+    NodePtr pack(NodePtr in, Encoding encoding);
+
+    /// Evaluates nodes and remembers the results
+    class Graph {
+        std::mutex lock;
+        /// (key, width << 32 | height) -> result
+        std::map< std::pair<uint64_t, uint64_t>, std::shared_ptr<const Image> > memo;
+
+    public:
+        /// Shared by every surface, so they can reuse each other's results
+        static Graph& shared();
+
+        /// @return The result of node, generated only if it is not remembered already
+        std::shared_ptr<const Image> evaluate(const NodePtr& node, uint32_t w, uint32_t h);
+
+        /// Forgets every result, their buffers go back to the pool once nothing else holds them
+        void clear();
+
+        /// Number of results remembered
+        size_t size();
+    };
+}
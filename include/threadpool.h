@@ -0,0 +1,169 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * Counts jobs still to finish, see ThreadPool::run(). Wait on it with
+ * ThreadPool::wait(), or make jobs depend on it with ThreadPool::after().
+ * A job which throws still counts as finished, wait() rethrows the first
+ * exception.
+ */
+class JobCounter {
+    size_t pending;
+    /// The first exception a counted job threw
+    std::exception_ptr error;
+    /// Queued by after() once pending reaches zero
+    std::vector< std::function<void()> > continuations;
+    mutable std::mutex lock;
+    std::condition_variable zero;
+
+    friend class ThreadPool;
+    void add();
+    void done();
+    /// Keeps e for wait() unless an earlier job already threw
+    void fail(std::exception_ptr e);
+    /// Runs job and counts it as done, whether or not it throws
+    void finish(const std::function<void()>& job);
+
+public:
+    JobCounter() : pending(0) {}
+
+    JobCounter(const JobCounter&) = delete;
+    JobCounter& operator=(const JobCounter&) = delete;
+
+    bool finished() const;
+};
+
+/**
+ * A fixed set of worker threads which run queued jobs. Nothing here touches
+ * OpenGL, so only hand it work which does not need a current context.
+ *
+ * Each worker has a deque of its own: jobs queued from a worker go on the
+ * back of its deque and it takes them from there, newest first, while idle
+ * workers steal the oldest from the front of someone else's. Jobs from any
+ * other thread go through a shared queue. A thread waiting for jobs runs
+ * queued ones meanwhile, so jobs may wait for other jobs.
+ */
+class ThreadPool {
+public:
+    typedef std::function<void()> Job;
+
+    struct WorkerStats {
+        uint64_t jobs;
+        /// Of jobs, how many were taken from another worker
+        uint64_t steals;
+        double busy_ms;
+    };
+
+    struct Stats {
+        /// Since the pool started or resetStats()
+        double elapsed_ms;
+        std::vector<WorkerStats> workers;
+    };
+
+private:
+    struct Worker {
+        std::mutex lock;
+        std::deque<Job> jobs;
+        std::atomic<uint64_t> jobs_run;
+        std::atomic<uint64_t> steals;
+        std::atomic<uint64_t> busy_ns;
+
+        Worker() : jobs_run(0), steals(0), busy_ns(0) {}
+    };
+
+    std::vector< std::unique_ptr<Worker> > queues;
+    std::vector<std::thread> workers;
+    /// Jobs from threads which are not workers
+    std::deque<Job> injected;
+    std::mutex injected_lock;
+
+    /// Jobs queued and not yet taken, workers sleep while it is 0
+    std::atomic<size_t> queued;
+    std::mutex sleep_lock;
+    std::condition_variable wake;
+    bool stopping;
+
+    std::atomic<int64_t> stats_begin;
+
+    /// The worker running on this thread, if it is one of ours
+    static thread_local ThreadPool* current_pool;
+    static thread_local unsigned current_index;
+
+    void work(unsigned index);
+    void push(Job job);
+    /// Takes a job from this thread's deque, the shared queue or another worker
+    bool take(Job& job);
+    /// Runs one queued job, if there is one
+    bool runOne();
+
+public:
+    /// @param threads Number of workers, at least one is always created
+    explicit ThreadPool(unsigned threads = std::thread::hardware_concurrency());
+    /// Finishes any queued jobs and joins the workers
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /**
+     * Creates the pool global() returns, with threads workers. Does nothing if
+     * it already exists, global() creates it with a worker per core otherwise.
+     */
+    static void start(unsigned threads = std::thread::hardware_concurrency());
+    /// The pool shared by the whole application
+    static ThreadPool& global();
+
+    inline unsigned size() const { return workers.size(); }
+
+    /**
+     * Queue a job, which must not throw unless it is counted.
+     * @param counter If given, counts the job until it has run, and keeps
+     *                what it throws for wait()
+     */
+    void run(Job job, JobCounter* counter = nullptr);
+
+    /// Queues job once every job counted by dependency has finished
+    void after(JobCounter& dependency, Job job, JobCounter* counter = nullptr);
+
+    /**
+     * Runs queued jobs until every job counted by counter has finished, then
+     * rethrows the first exception any of them threw.
+     */
+    void wait(JobCounter& counter);
+
+    /**
+     * Queue a task to run on a worker.
+     * @return A future holding the result (or exception) of f
+     */
+    template<class F>
+    auto submit(F f) -> std::future<decltype(f())> {
+        typedef decltype(f()) Result;
+        auto task = std::make_shared< std::packaged_task<Result()> >(std::move(f));
+        std::future<Result> result = task->get_future();
+        run([task]() { (*task)(); });
+        return result;
+    }
+
+    /**
+     * Calls fn(i) for every i in [begin, end), spread over the workers. The
+     * calling thread helps out, so it is safe to call this from within a task.
+     * Returns once every call has finished. If one throws, indices not yet
+     * started are skipped and the first exception is rethrown.
+     */
+    void parallelFor(size_t begin, size_t end, const std::function<void(size_t)>& fn);
+
+    Stats stats() const;
+    void resetStats();
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+
+/**
+ * Three slots handed between one producer and one consumer without locks.
+ * The producer fills back() and publish()es it, the consumer picks up the
+ * newest published slot with update() and reads front(). Neither side ever
+ * waits for the other: the producer always has a free slot to write, and a
+ * slow consumer just misses the slots published in between.
+ *
+ * Each side owns its slot until it swaps it, so whatever is written to a
+ * slot before publish() is seen by the consumer after update().
+ */
+template<class T> class TripleBuffer {
+    /// Set on the middle index when it holds a slot the consumer has not seen
+    static const unsigned NEW = 4;
+
+    T m_slots[3];
+    std::atomic<unsigned> middle;
+    unsigned back_index;
+    unsigned front_index;
+
+public:
+    TripleBuffer() : m_slots(), middle(1), back_index(0), front_index(2) {}
+
+    TripleBuffer(const TripleBuffer&) = delete;
+    TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+    /// The producer's slot
+    inline T& back() { return m_slots[back_index]; }
+
+    /// Hands back() to the consumer and takes the slot it is not using
+    inline void publish() {
+        back_index = middle.exchange(back_index | NEW, std::memory_order_acq_rel) & 3;
+    }
+
+    /// @return true if a slot was published since the last update(), from either side
+    inline bool pending() const { return (middle.load(std::memory_order_acquire) & NEW) != 0; }
+
+    /**
+     * Makes the newest published slot front().
+     * @return false if nothing was published since the last update, front() stays
+     */
+    inline bool update() {
+        if(!pending()) return false;
+        front_index = middle.exchange(front_index, std::memory_order_acq_rel) & 3;
+        return true;
+    }
+
+    /// The consumer's slot
+    inline T& front() { return m_slots[front_index]; }
+
+    /// Every slot, for setting up and tearing down while neither side runs
+    inline T& slot(unsigned x) { return m_slots[x]; }
+};
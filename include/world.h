@@ -1,6 +1,16 @@
 #pragma once
 
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <string>
+#include <utility>
+
+#include "arena.h"
 #include "car.h"
+#include "drawlist.h"
+#include "entitystore.h"
+#include "scenefile.h"
 
 /**
  * The world, this contains all models which will be rendered in it, and is able
@@ -8,6 +18,13 @@
  * a relativly simple container for the world data.
  */
 struct World {
+    /**
+     * Materials and the meshes of the scene, freed together with the World.
+     * Declared first so it outlives everything pointing into it. Props
+     * reload() makes come from the heap instead, see propArena().
+     */
+    Arena arena;
+
     std::shared_ptr<Material> mtl_ground;
     std::shared_ptr<Material> mtl_track;
     std::shared_ptr<Material> mtl_tree;
@@ -18,7 +35,9 @@ struct World {
 
     glm::vec3 sun_direction;
     glm::vec3 sun_intensity;
-    glm::vec3 lamp_positions[12];
+    /// Lights the shader has room for, see lamps[] in flat.frag
+    static const unsigned MAX_LAMPS = 12;
+    glm::vec3 lamp_positions[MAX_LAMPS];
     glm::vec3 lamp_intensity;
 
     bool initlized;
@@ -26,37 +45,98 @@ struct World {
     /// bbox[0] represents min values, bbox[1] represents max vals
     glm::vec3 bbox[2];
 
-    SceneEntity* race_track;
-    std::vector<SceneEntity*> trees;
-    std::vector<SceneEntity*> lamps;
-    std::vector<SceneEntity*> buildings;
-    SceneEntity* ground;
+    /// Everything drawn, the groups below say which entities belong to what
+    EntityStore entities;
+    EntityStore::Group race_track;
+    std::vector<EntityStore::Group> trees;
+    std::vector<EntityStore::Group> lamps;
+    std::vector<EntityStore::Group> buildings;
+    EntityStore::Group ground;
+    /// Follows car_pivot, which render() keeps at the car
+    EntityStore::Group car_entities;
+    EntityStore::Pivot car_pivot;
     Car* car;
 
+    /// Set by applyGlobals(), which reload() runs on the render thread, read them through globals_lock
     glm::vec3 photo_pos;
     glm::vec3 observer_pos;
+    mutable std::mutex globals_lock;
+
+    /// CPU side of the meshes, started by the constructor and finished by init()
+    std::vector< std::future<void> > preparing;
+    /// Milliseconds taken by each startup phase, in the order they finished
+    std::vector< std::pair<std::string, double> > startup_times;
+    std::mutex startup_lock;
+    std::chrono::steady_clock::time_point startup_begin;
+
+    /// The JSON (or compiled .scene) the world was loaded from
+    std::string scene_file;
+    /// What the entities were built from, reload() compares against it
+    SceneFile::Scene scene;
 
     World(const std::string& file_name, Shader& s);
     ~World();
 
-    /// Initlize the meshes, this prevents calls to GL before it is ready.
+    /// Reads scene_file, through the compiled scene when it is up to date
+    bool readScene(SceneFile::Scene& out);
+    /// Copies everything but the props out of scene
+    void applyGlobals();
+    /// photo_pos, from any thread
+    glm::vec3 photoPosition() const;
+    /// observer_pos, from any thread
+    glm::vec3 observerPosition() const;
+    /// arena while the scene is first built, null after, so props reload() replaces give their memory back
+    inline Arena* propArena() { return initlized ? nullptr : &arena; }
+    EntityStore::Group makeGround();
+    EntityStore::Group makeTrack();
+    EntityStore::Group makeTree(const float* position, float height);
+    EntityStore::Group makeBuilding(const float* outline, const float* heights);
+    EntityStore::Group makeLamp(const float* position, float height);
+
+    /**
+     * Reads scene_file again and rebuilds only what changed in it: props are
+     * matched by their data, so unchanged trees, lamps and buildings keep
+     * their meshes. The track and ground are rebuilt only if their data
+     * changed. The car keeps driving, the start position only applies to a
+     * new World. An OpenGL context must be current.
+     *
+     * @return false if the file could not be read, the old scene stays
+     */
+    bool reload();
+
+    /// Runs prepare() for each mesh on the thread pool, timed as phase
+    void prepareAsync(const std::string& phase, const std::vector< std::shared_ptr<Mesh> >& meshes);
+    /// prepareAsync() for the meshes of every group
+    void prepareAsync(const std::string& phase, const std::vector<EntityStore::Group>& groups);
+    /// Records how long phase has taken since began, from any thread
+    void recordPhase(const std::string& phase, std::chrono::steady_clock::time_point began);
+
+    /**
+     * Initlize the meshes, this prevents calls to GL before it is ready. Waits
+     * for the work started by the constructor, so only uploads happen here.
+     */
     void init();
 
-    inline void render() {
+    /// What the last render() drew
+    DrawList draws;
+
+    /// Sets the sun and lamp uniforms, which the shader wants in view space
+    void setLightUniforms(glm::mat4 view);
+
+    /**
+     * Draws what is inside the frustum of view_proj and big enough to see from
+     * eye, with the car at car_transform. The car is driven on another thread,
+     * so where it is comes from the caller rather than car.
+     */
+    inline void render(const glm::mat4& view_proj, const glm::vec3& eye, const glm::mat4& car_transform) {
         if(!initlized) init();
-        glm::mat4 objtowld = glm::mat4(); // TODO: consider making this the projection and view transform
-
-        if(race_track) {
-            QOpenGLFunctions_4_1_Core* gl =
-        		  QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_4_1_Core>();
-            gl->glActiveTexture(GL_TEXTURE0);
-            race_track->render(objtowld);
-        }
-
-        for(auto&& i : trees) i->render(objtowld);
-        for(auto&& i : lamps) i->render(objtowld);
-        for(auto&& i : buildings)  i->render(objtowld);
-        if(ground)     ground->render(objtowld);
-        if(car)        car->render(objtowld);
+        entities.setPivot(car_pivot, car_transform);
+        entities.updateTransforms();
+        draws.build(entities, view_proj, eye);
+
+        QOpenGLFunctions_4_1_Core* gl =
+              QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_4_1_Core>();
+        gl->glActiveTexture(GL_TEXTURE0);
+        draws.submit(entities, shader);
     }
 };
@@ -1,4 +1,4 @@
-CONFIG += debug testcase C++11
+CONFIG += debug testcase c++14
 TEMPLATE = app
 win32 { TEMPLATE = vcapp } #For stupid systems
 QT += gui widgets testlib
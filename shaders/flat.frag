@@ -17,10 +17,23 @@ uniform vec3 Kd;
 uniform vec3 Ks;
 uniform float shine;
 
+// Per vertex materials, replace the ones above when use_material_block is set
+struct MaterialData {
+    vec4 Le;
+    vec4 Ka;
+    vec4 Kd;
+    vec4 Ks; // w is shine
+};
+layout(std140) uniform Materials {
+    MaterialData materials[128]; // ObjMesh::MAX_MATERIALS
+};
+uniform bool use_material_block = false;
+
 // Vertex Shading Information
 in vec3 normal;
 in vec3 tangent;
 in vec3 eyepos; //position in eye coordinates
+flat in int material;
 
 //Textures and Normal Maps
 in vec2 itex_coord;
@@ -39,6 +52,16 @@ void main() {
         return;
     }
 
+    vec3 le = Le, ka = Ka, kd = Kd, ks = Ks;
+    float sh = shine;
+    if(use_material_block) {
+        le = materials[material].Le.xyz;
+        ka = materials[material].Ka.xyz;
+        kd = materials[material].Kd.xyz;
+        ks = materials[material].Ks.xyz;
+        sh = materials[material].Ks.w;
+    }
+
     vec3 n = normalize(normal);
     if(enable_normal_map) {
         vec3 t = normalize(tangent);
@@ -47,7 +70,11 @@ void main() {
         // Matrix to transform from tangent space to cameraspace
         mat3 tanspace = mat3(t, b, n);
 
-        n = tanspace * normalize(texture(normal_map, itex_coord).rgb * 2.0 - 1.0);
+        // Only x and y are stored, z is always positive in tangent space
+        vec3 tn;
+        tn.xy = texture(normal_map, itex_coord).rg * 2.0 - 1.0;
+        tn.z = sqrt(max(1.0 - dot(tn.xy, tn.xy), 0.0));
+        n = tanspace * normalize(tn);
 
         //fragColor = texture(normal_map, itex_coord);
         //return;
@@ -60,18 +87,18 @@ void main() {
         vec3 l = normalize( lamps[x] - eyepos );
         vec3 h = normalize( l + v );
 
-        vec3 tmp = Kd * max(dot(n, l), 0); //diffuse
-        tmp += Ks * pow(max(dot(h, n), 0), shine); //specular
+        vec3 tmp = kd * max(dot(n, l), 0); //diffuse
+        tmp += ks * pow(max(dot(h, n), 0), sh); //specular
         light_sum += tmp * (lamp_intensity / pow(length(lamps[x] - eyepos), 2)); //intensity / distance-squared
     }
-    light_sum += Ka*La; // ambient light
-    light_sum += Le; // emmission
+    light_sum += ka*La; // ambient light
+    light_sum += le; // emmission
 
     // Sun
     vec3 l = normalize( sun_direction );
     vec3 h = normalize( l + v );
-    vec3 tmp = Kd * max(dot(n, l), 0); //diffuse
-    tmp += Ks * pow(max(dot(h, n), 0), shine); //specular
+    vec3 tmp = kd * max(dot(n, l), 0); //diffuse
+    tmp += ks * pow(max(dot(h, n), 0), sh); //specular
     light_sum += tmp * sun_intensity;
 
     fragColor = vec4(light_sum, 1); //ambient + diffuse + Specular
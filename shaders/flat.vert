@@ -3,6 +3,7 @@
 layout(location=1) in vec4 vPosition;
 layout(location=2) in vec4 vNormal;
 layout(location=4) in vec2 tex_coord;
+layout(location=5) in float vMaterial; // Index into Materials, only set by ObjMesh
 
 uniform mat4 proj; // Projection
 uniform mat4 view; // worldtoview
@@ -13,9 +14,11 @@ out vec2 itex_coord;
 out vec3 normal;
 out vec3 tangent;
 out vec3 eyepos;
+flat out int material;
 
 void main() {
     itex_coord = tex_coord;
+    material = int(vMaterial + 0.5);
     mat4 toeye = view * obj;
     eyepos = (toeye * vPosition).xyz;
     mat3 normal_matrix = mat3(toeye[0].xyz, toeye[1].xyz, toeye[2].xyz);
@@ -0,0 +1,42 @@
+#version 410
+
+// Procedural::generateNormalMap, the sum of the normals of the eight triangles
+// fanned around each texel. The cross products are written out, see rowSSE2
+// in normalkernel.cpp.
+
+uniform sampler2D heights;
+
+// Only x and y, like the RGTC2 map of the CPU path, the shader reconstructs z
+layout(location = 0) out vec2 normal;
+
+ivec2 size;
+
+// Neighbours wrap, this makes the seams much harder to spot
+float heightAt(ivec2 at) {
+    return texelFetch(heights, (at + size) % size, 0).r;
+}
+
+void main() {
+    size = textureSize(heights, 0);
+    ivec2 c = ivec2(gl_FragCoord.xy); // column, row
+
+    // Counter-clockwise around the square starting at the right apothem,
+    // row - 1 is "up" on the CPU
+    float hc = heightAt(c);
+    float z0 = heightAt(c + ivec2( 1,  0)) - hc;
+    float z1 = heightAt(c + ivec2( 1, -1)) - hc;
+    float z2 = heightAt(c + ivec2( 0, -1)) - hc;
+    float z3 = heightAt(c + ivec2(-1, -1)) - hc;
+    float z4 = heightAt(c + ivec2(-1,  0)) - hc;
+    float z5 = heightAt(c + ivec2(-1,  1)) - hc;
+    float z6 = heightAt(c + ivec2( 0,  1)) - hc;
+    float z7 = heightAt(c + ivec2( 1,  1)) - hc;
+
+    vec3 sum;
+    sum.x = -z0 + (z2 - z1) + (z3 - z2) + z4 + z4 + (z5 - z6) + (z6 - z7) - z0;
+    sum.y = (z0 - z1) - z2 - z2 + (z4 - z3) + (z5 - z4) + z6 + z6 + (z7 - z0);
+    sum.z = 8.0;
+
+    // The CPU truncates, the conversion to GL_RG8 would round
+    normal = floor((normalize(sum).xy + 1.0) / 2.0 * 255.0) / 255.0;
+}
@@ -0,0 +1,18 @@
+#version 410
+
+// Normalizes the noise to 8 bit heights the same way Procedural::generateHeightMap does
+
+uniform sampler2D noise;
+uniform sampler2D range; // 1x1, min and max of noise
+
+layout(location = 0) out float height;
+
+void main() {
+    vec2 r = texelFetch(range, ivec2(0), 0).rg;
+    float val = texelFetch(noise, ivec2(gl_FragCoord.xy), 0).r;
+    val += abs(r.x);
+    val /= r.y - r.x;
+
+    // The CPU truncates, the conversion to GL_R8 would round
+    height = floor(255.0 * val) / 255.0;
+}
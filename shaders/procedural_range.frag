@@ -0,0 +1,23 @@
+#version 410
+
+// One step of reducing a texture to its min (r) and max (g), 4x4 texels at a time
+
+uniform sampler2D source;
+uniform bool first = false; // source is the noise itself, only r is used
+
+layout(location = 0) out vec2 range;
+
+void main() {
+    ivec2 size = textureSize(source, 0);
+    ivec2 base = ivec2(gl_FragCoord.xy) * 4;
+
+    range = vec2(1e10, -1e10);
+    for(int y = 0; y < 4; ++y) {
+        for(int x = 0; x < 4; ++x) {
+            // Off the edge just repeats the last texel
+            vec4 t = texelFetch(source, min(base + ivec2(x, y), size - 1), 0);
+            vec2 v = first ? t.rr : t.rg;
+            range = vec2(min(range.x, v.x), max(range.y, v.y));
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#include "arena.h"
+
+#include <algorithm>
+
+Arena::Arena(size_t block_size) :
+        blocks(nullptr), cursor(nullptr), end(nullptr), finalizers(nullptr), block_size(block_size),
+        m_allocations(0), m_bytes(0), m_blocks(0) {}
+
+Arena::~Arena() {
+    clear();
+}
+
+void* Arena::allocate(size_t bytes, size_t alignment) {
+    uintptr_t at = (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    if(cursor == nullptr || at + bytes > reinterpret_cast<uintptr_t>(end)) {
+        // Anything larger than a block gets a block of its own
+        const size_t header = (sizeof(Block) + alignment - 1) & ~(alignment - 1);
+        const size_t size = std::max(block_size, header + bytes);
+        Block* block = static_cast<Block*>(::operator new(size));
+        block->next = blocks;
+        block->size = size;
+        blocks = block;
+        ++m_blocks;
+
+        cursor = reinterpret_cast<uint8_t*>(block) + sizeof(Block);
+        end = reinterpret_cast<uint8_t*>(block) + size;
+        at = (reinterpret_cast<uintptr_t>(cursor) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+    }
+
+    uint8_t* p = reinterpret_cast<uint8_t*>(at);
+    m_bytes += p + bytes - cursor;
+    ++m_allocations;
+    cursor = p + bytes;
+    return p;
+}
+
+void Arena::clear() {
+    for(Finalizer* f = finalizers; f != nullptr; f = f->next) f->destroy(f->object);
+    finalizers = nullptr;
+
+    while(blocks != nullptr) {
+        Block* next = blocks->next;
+        ::operator delete(blocks);
+        blocks = next;
+    }
+    cursor = end = nullptr;
+}
@@ -7,12 +7,11 @@ Building::Building(glm::vec3 b[], float h[]) {
     }
 }
 
-void Building::init() {
-    if (m_vao != 0) return;
-
-	std::vector<GLfloat> pts;
-	std::vector<GLfloat> norm;
-	std::vector<GLuint> el;
+MeshData Building::build() const {
+	MeshData data;
+	std::vector<GLfloat>& pts = data.positions;
+	std::vector<GLfloat>& norm = data.normals;
+	std::vector<GLuint>& el = data.indices;
 
 	// Side faces
 	buildFace(pts, norm, el, 0, 1);
@@ -24,11 +23,11 @@ void Building::init() {
 	buildTopTri(pts, norm, el, 0, 1, 2);
 	buildTopTri(pts, norm, el, 0, 2, 3);
 
-	TriangleMesh::init(&el, &pts, &norm);
+	return data;
 }
 
 void Building::buildFace(std::vector<GLfloat>& pts, std::vector<GLfloat>& norm,
-                         std::vector<GLuint>& el, int idx1, int idx2) {
+                         std::vector<GLuint>& el, int idx1, int idx2) const {
 	GLuint start = pts.size() / 3;
 	glm::vec3 p[4];
 	p[0] = base[idx1];
@@ -47,7 +46,7 @@ void Building::buildFace(std::vector<GLfloat>& pts, std::vector<GLfloat>& norm,
 }
 
 void Building::buildTopTri(std::vector<GLfloat>& pts, std::vector<GLfloat>& norm,
-	                       std::vector<GLuint>& el, int idx1, int idx2, int idx3) {
+	                       std::vector<GLuint>& el, int idx1, int idx2, int idx3) const {
 	GLuint start = pts.size() / 3;
 	glm::vec3 p[3];
 	p[0] = glm::vec3(base[idx1].x, height[idx1], base[idx1].z);
@@ -5,7 +5,7 @@
 
 #include "camera.h"
 
-Camera::Camera() {
+Camera::Camera() : view_dirty(true), projection_dirty(true) {
     setViewVolume(
         45.0f, // Fovy
         4.0f / 3.0f,                  // Aspect
@@ -19,10 +19,12 @@ void Camera::orient(const glm::vec3& position, const glm::vec3& at, const glm::v
     n = glm::normalize(position - at);
     u = glm::normalize(glm::cross(up, n));
     v = glm::normalize(glm::cross(n, u));
+    view_dirty = true;
 }
 
 void Camera::slide(const glm::vec3& d) {
     position += d.x * u + d.y * v + d.z * n;
+    view_dirty = true;
 }
 
 void Camera::slideXZ(const glm::vec3& d) {
@@ -30,6 +32,7 @@ void Camera::slideXZ(const glm::vec3& d) {
     glm::vec3 tmp = d.x * u + d.y * v + d.z * n * factor;
     tmp.y = 0;
     position += tmp;
+    view_dirty = true;
 }
 
 void Camera::slideY(const glm::vec3& d) {
@@ -38,6 +41,7 @@ void Camera::slideY(const glm::vec3& d) {
     tmp.x = 0;
     tmp.z = 0;
     position += tmp;
+    view_dirty = true;
 }
 
 void Camera::rotate(float angle, const glm::vec3& axis) {
@@ -47,6 +51,7 @@ void Camera::rotate(float angle, const glm::vec3& axis) {
     u = glm::normalize(r * u);
     v = glm::normalize(r * v);
     n = glm::normalize(r * n);
+    view_dirty = true;
 }
 
 void Camera::pitch(float angle) {
@@ -59,13 +64,31 @@ void Camera::pitch(float angle) {
     v = glm::normalize(v2);
     n = glm::normalize(n2);
     u = glm::normalize(glm::cross(v, n));
+    view_dirty = true;
 }
 
-glm::mat4 Camera::getProjectionMatrix() const {
-    return glm::perspective(fovy, aspect, near_plane, far_plane);
+Camera Camera::interpolate(const Camera& a, const Camera& b, float t) {
+    // Close enough to slerping over the few degrees a tick turns
+    Camera c = b;
+    c.position = glm::mix(a.position, b.position, t);
+    c.n = glm::normalize(glm::mix(a.n, b.n, t));
+    c.u = glm::normalize(glm::cross(glm::mix(a.v, b.v, t), c.n));
+    c.v = glm::normalize(glm::cross(c.n, c.u));
+    c.view_dirty = true;
+    return c;
 }
 
-glm::mat4 Camera::getViewMatrix() const {
+const glm::mat4& Camera::getProjectionMatrix() const {
+    if(projection_dirty) {
+        projection = glm::perspective(fovy, aspect, near_plane, far_plane);
+        projection_dirty = false;
+    }
+    return projection;
+}
+
+const glm::mat4& Camera::getViewMatrix() const {
+    if(!view_dirty) return view;
+
     glm::mat4 rotate(
         glm::vec4(u, 0),
         glm::vec4(v, 0),
@@ -76,7 +99,7 @@ glm::mat4 Camera::getViewMatrix() const {
     glm::mat4 translate;
     translate[3] = glm::vec4(-1.0f * position, 1.0f);
 
-    glm::mat4 view = rotate * translate;
-
+    view = rotate * translate;
+    view_dirty = false;
     return view;
 }
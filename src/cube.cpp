@@ -1,32 +1,30 @@
 #include "shapes.h"
+#include "shapegeometry.h"
 
-void Cube::init() {
-    if(m_vao != 0) return;
-
-    GLfloat side2 = m_side * 0.5f;
-
-    std::vector<GLfloat> points {
+namespace {
+    /// A cube with sides of 1, four vertices per face so each has its own normal
+    constexpr GLfloat POSITIONS[] = {
         // Front
-        -side2,-side2,side2,  side2,-side2,side2,
-        side2,side2,side2,   -side2,side2,side2,
+        -0.5f,-0.5f,0.5f,  0.5f,-0.5f,0.5f,
+        0.5f,0.5f,0.5f,   -0.5f,0.5f,0.5f,
         // Right
-        side2,-side2,side2,  side2,-side2,-side2,
-        side2,side2,-side2,   side2,side2,side2,
+        0.5f,-0.5f,0.5f,  0.5f,-0.5f,-0.5f,
+        0.5f,0.5f,-0.5f,   0.5f,0.5f,0.5f,
         // Back
-        -side2,-side2,-side2, -side2,side2,-side2,
-        side2,side2,-side2,   side2,-side2,-side2,
+        -0.5f,-0.5f,-0.5f, -0.5f,0.5f,-0.5f,
+        0.5f,0.5f,-0.5f,   0.5f,-0.5f,-0.5f,
         // Left
-        -side2,-side2,side2,  -side2,side2,side2,
-        -side2,side2,-side2, -side2,-side2,-side2,
+        -0.5f,-0.5f,0.5f,  -0.5f,0.5f,0.5f,
+        -0.5f,0.5f,-0.5f, -0.5f,-0.5f,-0.5f,
         // Bottom
-        -side2,-side2,side2,  -side2,-side2,-side2,
-        side2,-side2,-side2,  side2,-side2,side2,
+        -0.5f,-0.5f,0.5f,  -0.5f,-0.5f,-0.5f,
+        0.5f,-0.5f,-0.5f,  0.5f,-0.5f,0.5f,
         // Top
-        -side2,side2,side2,   side2,side2,side2,
-        side2,side2,-side2,  -side2,side2,-side2
+        -0.5f,0.5f,0.5f,   0.5f,0.5f,0.5f,
+        0.5f,0.5f,-0.5f,  -0.5f,0.5f,-0.5f
     };
 
-    std::vector<GLfloat> normals {
+    constexpr GLfloat NORMALS[] = {
         // Front
         0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f,
         // Right
@@ -41,7 +39,7 @@ void Cube::init() {
         0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 1.0f, 0.0f
     };
 
-    std::vector<GLuint> elements {
+    constexpr GLuint INDICES[] = {
         0,1,2,0,2,3,
         4,5,6,4,6,7,
         8,9,10,8,10,11,
@@ -49,6 +47,9 @@ void Cube::init() {
         16,17,18,16,18,19,
         20,21,22,20,22,23
     };
+}
 
-    TriangleMesh::init(&elements, &points, &normals);
+MeshData Cube::build() const {
+    const ShapeGeometry::View cube = { POSITIONS, NORMALS, 24, INDICES, 36 };
+    return ShapeGeometry::scaled(cube, glm::vec3(m_side));
 }
@@ -0,0 +1,142 @@
+#include "drawlist.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include "threadpool.h"
+
+constexpr float DrawList::MIN_SIZE;
+const size_t DrawList::BLOCK;
+
+namespace {
+    const uint32_t NONE = 0xffffffff;
+
+    bool before(const DrawList::Packet& a, const DrawList::Packet& b) {
+        return a.key < b.key || (a.key == b.key && a.entity < b.entity);
+    }
+
+    /**
+     * Draws sharing a material, then a mesh, end up next to each other, and
+     * each run goes front to back. Distances are positive floats, so their
+     * bits sort the same as they do. EntityStore keeps the handles within
+     * their bits.
+     */
+    static_assert(EntityStore::MATERIAL_BITS + EntityStore::MESH_BITS <= 32, "Handles do not fit a sort key");
+    uint64_t sortKey(EntityStore::MaterialHandle material, EntityStore::MeshHandle mesh, float distance) {
+        uint32_t depth;
+        std::memcpy(&depth, &distance, sizeof(depth));
+        return (uint64_t)material << (32 + EntityStore::MESH_BITS) | (uint64_t)mesh << 32 | depth;
+    }
+}
+
+void DrawList::build(const EntityStore& store, const glm::mat4& view_proj, const glm::vec3& eye, float min_size) {
+    // The six planes of the frustum, from the rows of view_proj (Gribb and Hartmann)
+    glm::vec4 planes[6];
+    const glm::vec4 w(view_proj[0][3], view_proj[1][3], view_proj[2][3], view_proj[3][3]);
+    for(int r = 0; r < 3; ++r) {
+        const glm::vec4 row(view_proj[0][r], view_proj[1][r], view_proj[2][r], view_proj[3][r]);
+        planes[2 * r] = w + row;
+        planes[2 * r + 1] = w - row;
+    }
+
+    // A buffer per block, not per thread: any thread waiting on the pool may run
+    // a block, the GUI, render and simulation threads as well as the workers
+    const size_t count = store.size();
+    const size_t blocks = (count + BLOCK - 1) / BLOCK;
+    buffers.resize(blocks);
+    merged.resize(blocks);
+    small_counts.assign(blocks, 0);
+    for(auto&& i : buffers) i.clear();
+
+    ThreadPool& pool = ThreadPool::global();
+    pool.parallelFor(0, blocks, [&](size_t block) {
+        std::vector<Packet>& out = buffers[block];
+        const size_t end = std::min(count, (block + 1) * BLOCK);
+        for(size_t x = block * BLOCK; x < end; ++x) {
+            const EntityStore::Bounds& b = store.bounds[x];
+
+            bool inside = true;
+            for(int p = 0; p < 6 && inside; ++p) {
+                // The corner furthest along the plane's normal
+                const glm::vec4& n = planes[p];
+                inside = n.x * (n.x > 0 ? b.max.x : b.min.x) +
+                         n.y * (n.y > 0 ? b.max.y : b.min.y) +
+                         n.z * (n.z > 0 ? b.max.z : b.min.z) + n.w >= 0.0f;
+            }
+            if(!inside) continue;
+
+            // Too small to see from here, unknown bounds are infinite so always pass
+            const glm::vec3 centre = 0.5f * (b.min + b.max);
+            const glm::vec3 half = 0.5f * (b.max - b.min);
+            const float radius = glm::sqrt(glm::dot(half, half));
+            const glm::vec3 to = centre - eye;
+            const float distance = glm::sqrt(glm::dot(to, to));
+            if(radius < min_size * distance) {
+                ++small_counts[block];
+                continue;
+            }
+
+            Packet packet;
+            packet.key = sortKey(store.materials[x], store.meshes[x], distance);
+            packet.entity = x;
+            out.push_back(packet);
+        }
+    });
+
+    // Each buffer sorted on its own, then merged in pairs, a round at a time,
+    // until buffers[0] holds them all
+    pool.parallelFor(0, blocks, [this](size_t i) {
+        std::sort(buffers[i].begin(), buffers[i].end(), before);
+    });
+    for(size_t width = 1; width < blocks; width *= 2) {
+        const size_t pairs = (blocks + 2 * width - 1) / (2 * width);
+        pool.parallelFor(0, pairs, [this, width, blocks](size_t pair) {
+            const size_t left = pair * 2 * width;
+            const size_t right = left + width;
+            if(right >= blocks) return; // Odd one out, merged in a later round
+            std::vector<Packet>& out = merged[left];
+            out.resize(buffers[left].size() + buffers[right].size());
+            std::merge(buffers[left].begin(), buffers[left].end(), buffers[right].begin(), buffers[right].end(),
+                       out.begin(), before);
+            // Swapped, so every vector keeps its capacity for the next frame
+            buffers[left].swap(out);
+        });
+    }
+
+    packets.clear();
+    if(blocks != 0) packets.swap(buffers[0]);
+    too_small = 0;
+    for(auto&& i : small_counts) too_small += i;
+}
+
+void DrawList::submit(const EntityStore& store, Shader& shader) const {
+    uint32_t last_mesh = NONE;
+    uint32_t last_material = NONE;
+    int last_normal_map = -1;
+
+    for(auto&& p : packets) {
+        const uint32_t x = p.entity;
+        const EntityStore::MeshHandle handle = store.meshes[x];
+        Mesh& mesh = store.mesh(handle);
+        if(handle != last_mesh) {
+            mesh.setUniform(shader);
+            last_mesh = handle;
+        }
+
+        shader.setUniform("obj", store.transforms[x]);
+
+        const EntityStore::MaterialHandle material = store.materials[x];
+        if(material != last_material && material != EntityStore::NO_MATERIAL)
+            store.material(material).setUniforms(shader);
+        // A mesh without a material of its own sets them as it draws
+        last_material = material != EntityStore::NO_MATERIAL ? material : NONE;
+
+        const int normal_map = (store.flags[x] & EntityStore::NORMAL_MAP) != 0;
+        if(normal_map != last_normal_map) {
+            shader.setUniform("enable_normal_map", normal_map != 0);
+            last_normal_map = normal_map;
+        }
+
+        mesh.render();
+    }
+}
@@ -0,0 +1,247 @@
+#include "entitystore.h"
+
+#include <algorithm>
+#include <limits>
+#include <unordered_set>
+
+const EntityStore::MaterialHandle EntityStore::NO_MATERIAL;
+const unsigned EntityStore::MESH_BITS;
+const unsigned EntityStore::MATERIAL_BITS;
+const EntityStore::Pivot EntityStore::NO_PIVOT;
+const uint32_t EntityStore::INVALID;
+
+EntityStore::EntityStore() : dirty(false) {
+    // Handle 0 is NO_MATERIAL
+    material_table.push_back(nullptr);
+}
+
+EntityStore::~EntityStore() {}
+
+EntityStore::Id EntityStore::create(MeshHandle mesh, MaterialHandle material, const glm::mat4& local,
+                                    uint8_t entity_flags, Pivot pivot) {
+    Id id;
+    if(!free_ids.empty()) {
+        id = free_ids.back();
+        free_ids.pop_back();
+    } else {
+        id = dense.size();
+        dense.push_back(INVALID);
+    }
+
+    dense[id] = transforms.size();
+    ids.push_back(id);
+    locals.push_back(local);
+    pivots.push_back(pivot);
+    transforms.push_back(pivot != NO_PIVOT ? pivot_worlds[pivot] * local : local);
+    meshes.push_back(mesh);
+    materials.push_back(material);
+    flags.push_back(entity_flags & ~DIRTY);
+    bounds.push_back(worldBounds(mesh, transforms.back()));
+    ++mesh_users[mesh];
+    return id;
+}
+
+void EntityStore::destroy(Id id) {
+    const uint32_t at = dense[id];
+    if(at == INVALID) return;
+
+    const MeshHandle mesh = meshes[at];
+    if(--mesh_users[mesh] == 0) {
+        mesh_lookup.erase(mesh_table[mesh].get());
+        mesh_table[mesh].reset();
+        free_meshes.push_back(mesh);
+    }
+
+    // The last entity takes the place of the destroyed one
+    const uint32_t last = transforms.size() - 1;
+    if(at != last) {
+        locals[at] = locals[last];
+        pivots[at] = pivots[last];
+        transforms[at] = transforms[last];
+        meshes[at] = meshes[last];
+        materials[at] = materials[last];
+        flags[at] = flags[last];
+        bounds[at] = bounds[last];
+        ids[at] = ids[last];
+        dense[ids[at]] = at;
+    }
+    locals.pop_back();
+    pivots.pop_back();
+    transforms.pop_back();
+    meshes.pop_back();
+    materials.pop_back();
+    flags.pop_back();
+    bounds.pop_back();
+    ids.pop_back();
+
+    dense[id] = INVALID;
+    free_ids.push_back(id);
+}
+
+EntityStore::Group EntityStore::add(const MultiEntity& e, const glm::mat4& parent) {
+    Group group;
+    const glm::mat4 objtowld = parent * e.objtowld;
+    for(const MultiEntity* i = &e; i != nullptr; i = i->next) {
+        group.push_back(create(addMesh(i->mesh), addMaterial(i->material), objtowld * (*i->transform),
+                               i->normal_map ? NORMAL_MAP : 0));
+    }
+    return group;
+}
+
+EntityStore::Group EntityStore::add(const MultiEntity& e, Pivot pivot) {
+    Group group;
+    for(const MultiEntity* i = &e; i != nullptr; i = i->next) {
+        group.push_back(create(addMesh(i->mesh), addMaterial(i->material), e.objtowld * (*i->transform),
+                               i->normal_map ? NORMAL_MAP : 0, pivot));
+    }
+    return group;
+}
+
+EntityStore::Group EntityStore::add(const SceneEntity& e) {
+    return Group(1, create(addMesh(e.mesh), addMaterial(e.material), *e.transform,
+                           e.normal_map ? NORMAL_MAP : 0));
+}
+
+void EntityStore::destroy(const Group& group) {
+    for(auto&& i : group) destroy(i);
+}
+
+void EntityStore::setLocal(Id id, const glm::mat4& local) {
+    const uint32_t at = dense[id];
+    locals[at] = local;
+    flags[at] |= DIRTY;
+    dirty = true;
+}
+
+EntityStore::Pivot EntityStore::createPivot(const glm::mat4& local, Pivot parent) {
+    const Pivot pivot = pivot_locals.size();
+    pivot_locals.push_back(local);
+    pivot_worlds.push_back(parent != NO_PIVOT ? pivot_worlds[parent] * local : local);
+    pivot_parents.push_back(parent);
+    // Picks up a parent that is still dirty
+    pivot_dirty.push_back(1);
+    dirty = true;
+    return pivot;
+}
+
+void EntityStore::setPivot(Pivot pivot, const glm::mat4& local) {
+    if(pivot_locals[pivot] == local) return;
+    pivot_locals[pivot] = local;
+    pivot_dirty[pivot] = 1;
+    dirty = true;
+}
+
+void EntityStore::updateTransforms() {
+    if(!dirty) return;
+
+    // Parents come before their children, so one pass carries dirt down the hierarchy
+    for(size_t p = 0; p < pivot_locals.size(); ++p) {
+        const Pivot parent = pivot_parents[p];
+        if(parent != NO_PIVOT && pivot_dirty[parent]) pivot_dirty[p] = 1;
+        if(!pivot_dirty[p]) continue;
+        pivot_worlds[p] = parent != NO_PIVOT ? pivot_worlds[parent] * pivot_locals[p] : pivot_locals[p];
+    }
+
+    for(size_t x = 0; x < transforms.size(); ++x) {
+        const Pivot pivot = pivots[x];
+        const bool moved = pivot != NO_PIVOT && pivot_dirty[pivot];
+        if(!moved && !(flags[x] & DIRTY)) continue;
+        transforms[x] = pivot != NO_PIVOT ? pivot_worlds[pivot] * locals[x] : locals[x];
+        bounds[x] = worldBounds(meshes[x], transforms[x]);
+        flags[x] &= ~DIRTY;
+    }
+
+    std::fill(pivot_dirty.begin(), pivot_dirty.end(), 0);
+    dirty = false;
+}
+
+EntityStore::MeshHandle EntityStore::addMesh(const std::shared_ptr<Mesh>& mesh) {
+    auto found = mesh_lookup.find(mesh.get());
+    if(found != mesh_lookup.end()) return found->second;
+
+    MeshHandle handle;
+    if(!free_meshes.empty()) {
+        handle = free_meshes.back();
+        free_meshes.pop_back();
+        mesh_table[handle] = mesh;
+    } else {
+        handle = mesh_table.size();
+        // Handles past this would share sort keys, and submit() would split their runs
+        if(handle >= 1u << MESH_BITS) qFatal("More than %u meshes in one EntityStore", 1u << MESH_BITS);
+        mesh_table.push_back(mesh);
+        mesh_users.push_back(0);
+    }
+    mesh_lookup[mesh.get()] = handle;
+    return handle;
+}
+
+EntityStore::MaterialHandle EntityStore::addMaterial(const std::shared_ptr<Material>& material) {
+    if(material == nullptr) return NO_MATERIAL;
+    auto found = material_lookup.find(material.get());
+    if(found != material_lookup.end()) return found->second;
+
+    // Materials are few and shared, so they are kept for the life of the store
+    const MaterialHandle handle = material_table.size();
+    if(handle >= 1u << MATERIAL_BITS) qFatal("More than %u materials in one EntityStore", 1u << MATERIAL_BITS);
+    material_table.push_back(material);
+    material_lookup[material.get()] = handle;
+    return handle;
+}
+
+std::vector< std::shared_ptr<Mesh> > EntityStore::meshesOf(const Group& group) const {
+    std::vector< std::shared_ptr<Mesh> > out;
+    std::unordered_set<MeshHandle> seen;
+    for(auto&& i : group) {
+        const MeshHandle mesh = meshes[dense[i]];
+        if(seen.insert(mesh).second) out.push_back(mesh_table[mesh]);
+    }
+    return out;
+}
+
+std::vector< std::shared_ptr<Mesh> > EntityStore::meshesOf(const std::vector<Group>& groups) const {
+    Group all;
+    for(auto&& i : groups) all.insert(all.end(), i.begin(), i.end());
+    return meshesOf(all);
+}
+
+void EntityStore::initMeshes() {
+    for(auto&& i : mesh_table)
+        if(i != nullptr && !i->isInit()) i->init();
+}
+
+void EntityStore::updateBounds() {
+    for(size_t x = 0; x < transforms.size(); ++x)
+        bounds[x] = worldBounds(meshes[x], transforms[x]);
+}
+
+void EntityStore::render(Shader& shader) const {
+    for(size_t x = 0; x < transforms.size(); ++x) {
+        Mesh& m = *mesh_table[meshes[x]];
+        m.setUniform(shader);
+        shader.setUniform("obj", transforms[x]);
+        if(materials[x] != NO_MATERIAL) material_table[materials[x]]->setUniforms(shader);
+        shader.setUniform("enable_normal_map", (flags[x] & NORMAL_MAP) != 0);
+        m.render();
+    }
+}
+
+EntityStore::Bounds EntityStore::worldBounds(MeshHandle mesh, const glm::mat4& transform) const {
+    Bounds b;
+    if(!mesh_table[mesh]->bounds(b.min, b.max)) {
+        // Unknown until prepared, so never culled
+        b.min = glm::vec3(-std::numeric_limits<float>::max());
+        b.max = glm::vec3(std::numeric_limits<float>::max());
+        return b;
+    }
+
+    // The box around the transformed box, from its centre and half size (Arvo)
+    const glm::vec3 centre = 0.5f * (b.min + b.max);
+    const glm::vec3 half = 0.5f * (b.max - b.min);
+    const glm::vec3 moved = glm::vec3(transform * glm::vec4(centre, 1.0f));
+    glm::vec3 reach(0.0f);
+    for(int c = 0; c < 3; ++c)
+        reach += glm::abs(glm::vec3(transform[c])) * half[c];
+    b.min = moved - reach;
+    b.max = moved + reach;
+    return b;
+}
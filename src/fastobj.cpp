@@ -0,0 +1,532 @@
+#include "fastobj.h"
+
+#include <QFileInfo>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <unordered_map>
+
+#include "mappedfile.h"
+#include "threadpool.h"
+
+namespace {
+    /// Chunks smaller than this are not worth handing to another thread
+    const size_t MIN_CHUNK = 1 << 20;
+
+    /// Indices of one corner of a face, -1 if not given. Same as tinyobj's vertex_index.
+    struct Corner {
+        int v, vt, vn;
+
+        inline bool operator==(const Corner& o) const { return v == o.v && vt == o.vt && vn == o.vn; }
+    };
+
+    struct CornerHash {
+        inline size_t operator()(const Corner& c) const {
+            return ((size_t)(uint32_t)c.v * 73856093u) ^ ((size_t)(uint32_t)c.vt * 19349663u) ^
+                   ((size_t)(uint32_t)c.vn * 83492791u);
+        }
+    };
+
+    /// A line which is not geometry, these are replayed in file order once every chunk is parsed
+    struct Event {
+        enum Kind { USEMTL, GROUP, OBJECT, MTLLIB } kind;
+        std::string name;
+        /// Number of faces in the chunk before this line
+        size_t face;
+    };
+
+    /// A negative index is relative to the vertices before it, which other chunks may hold
+    struct Relative {
+        size_t corner;
+        int Corner::* field;
+    };
+
+    struct Chunk {
+        const char* begin;
+        const char* end;
+
+        std::vector<float> v, vn, vt;
+        std::vector<Corner> corners;
+        /// Offset of each face's first corner in corners
+        std::vector<size_t> faces;
+        std::vector<Event> events;
+        std::vector<Relative> relative;
+
+        /// Counts in all the chunks before this one
+        size_t v_base, vn_base, vt_base, corner_base, face_base;
+    };
+
+    /// Faces drawn with one material, de-duplicated on their own like tinyobj's face groups
+    struct Group {
+        size_t begin, end;
+        int material;
+        bool bad_index;
+        tinyobj::mesh_t mesh;
+    };
+
+    struct Shape {
+        std::string name;
+        std::vector<size_t> groups;
+    };
+
+    inline bool isSpace(char c) { return c == ' ' || c == '\t'; }
+    inline bool isDigit(char c) { return (unsigned)(c - '0') < 10u; }
+
+    inline const char* skipSpace(const char* p, const char* end) {
+        while(p < end && isSpace(*p)) ++p;
+        return p;
+    }
+
+    /// strcspn(p, " \t\r")
+    inline const char* tokenEnd(const char* p, const char* end) {
+        while(p < end && !isSpace(*p) && *p != '\r') ++p;
+        return p;
+    }
+
+    /// sscanf(p, "%s"), empty if there is no word
+    std::string word(const char* p, const char* end) {
+        while(p < end && (isSpace(*p) || *p == '\r')) ++p;
+        return std::string(p, tokenEnd(p, end));
+    }
+
+    inline int parseInt(const char* p, const char* end) {
+        bool negative = false;
+        if(p < end && (*p == '-' || *p == '+')) negative = (*p++ == '-');
+        int value = 0;
+        while(p < end && isDigit(*p)) value = value * 10 + (*p++ - '0');
+        return negative ? -value : value;
+    }
+
+    /**
+     * Accumulates up to 19 significant digits as an integer and scales it once
+     * by an exact power of ten. That rounds correctly whenever the digits fit in
+     * a double's mantissa, which covers anything an exporter writes. Anything
+     * else goes to strtod.
+     */
+    bool parseDouble(const char* s, const char* end, double& out) {
+        static const double POW10[] = {
+            1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+            1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+        };
+        const char* const start = s;
+
+        bool negative = false;
+        if(s < end && (*s == '+' || *s == '-')) negative = (*s++ == '-');
+
+        uint64_t mantissa = 0;
+        int digits = 0, exponent = 0;
+        bool any = false;
+        for(; s < end && isDigit(*s); ++s, any = true) {
+            if(digits < 19) {
+                mantissa = mantissa * 10 + (*s - '0');
+                if(mantissa != 0) ++digits;
+            }
+            else ++exponent;
+        }
+        if(!any) return false;
+
+        if(s < end && *s == '.') {
+            for(++s; s < end && isDigit(*s); ++s) {
+                if(digits < 19) {
+                    mantissa = mantissa * 10 + (*s - '0');
+                    if(mantissa != 0) ++digits;
+                    --exponent;
+                }
+            }
+        }
+
+        if(s < end && (*s == 'e' || *s == 'E')) {
+            ++s;
+            bool exp_negative = false;
+            if(s < end && (*s == '+' || *s == '-')) exp_negative = (*s++ == '-');
+            if(s >= end || !isDigit(*s)) return false;
+            int e = 0;
+            for(; s < end && isDigit(*s); ++s)
+                if(e < 100000) e = e * 10 + (*s - '0');
+            exponent += exp_negative ? -e : e;
+        }
+
+        double value;
+        if(mantissa == 0)
+            value = 0.0;
+        else if(mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+            value = exponent < 0 ? (double)mantissa / POW10[-exponent] : (double)mantissa * POW10[exponent];
+        else {
+            char buffer[128];
+            const size_t length = std::min<size_t>(s - start, sizeof(buffer) - 1);
+            std::memcpy(buffer, start, length);
+            buffer[length] = '\0';
+            value = std::fabs(std::strtod(buffer, nullptr));
+        }
+
+        out = negative ? -value : value;
+        return true;
+    }
+
+    /// tinyobj's parseFloat, 0 if there is no number
+    inline float parseFloat(const char*& p, const char* end) {
+        p = skipSpace(p, end);
+        const char* token_end = tokenEnd(p, end);
+        double value = 0.0;
+        parseDouble(p, token_end, value);
+        p = token_end;
+        return (float)value;
+    }
+
+    void parseChunk(Chunk& c) {
+        // "/ \t\r"
+        const auto fieldEnd = [](const char* p, const char* end) {
+            while(p < end && *p != '/' && !isSpace(*p) && *p != '\r') ++p;
+            return p;
+        };
+
+        // Make an index zero based, see tinyobj's fixIndex
+        const auto fix = [&c](int idx, size_t count, int Corner::* field) {
+            if(idx > 0) return idx - 1;
+            if(idx == 0) return 0;
+            Relative r = { c.corners.size(), field };
+            c.relative.push_back(r);
+            return (int)count + idx;
+        };
+
+        for(const char* line = c.begin; line < c.end; ) {
+            const char* end = (const char*)std::memchr(line, '\n', c.end - line);
+            if(end == nullptr) end = c.end;
+            const char* next = end + 1;
+            if(end > line && end[-1] == '\r') --end;
+
+            const char* p = skipSpace(line, end);
+            line = next;
+            if(p >= end || *p == '#') continue;
+
+            const size_t length = end - p;
+            const auto keyword = [&](const char* name, size_t n) {
+                return length > n && std::strncmp(p, name, n) == 0 && isSpace(p[n]);
+            };
+
+            if(keyword("v", 1)) {
+                p += 2;
+                c.v.push_back(parseFloat(p, end));
+                c.v.push_back(parseFloat(p, end));
+                c.v.push_back(parseFloat(p, end));
+            }
+            else if(keyword("vn", 2)) {
+                p += 3;
+                c.vn.push_back(parseFloat(p, end));
+                c.vn.push_back(parseFloat(p, end));
+                c.vn.push_back(parseFloat(p, end));
+            }
+            else if(keyword("vt", 2)) {
+                p += 3;
+                c.vt.push_back(parseFloat(p, end));
+                c.vt.push_back(parseFloat(p, end));
+            }
+            else if(keyword("f", 1)) {
+                p = skipSpace(p + 2, end);
+                c.faces.push_back(c.corners.size());
+
+                // See tinyobj's parseTriple: i, i/j, i//k or i/j/k
+                while(p < end && *p != '\r') {
+                    Corner corner = { -1, -1, -1 };
+                    corner.v = fix(parseInt(p, end), c.v.size() / 3, &Corner::v);
+                    p = fieldEnd(p, end);
+                    if(p < end && *p == '/') {
+                        ++p;
+                        if(p < end && *p == '/') {
+                            ++p;
+                            corner.vn = fix(parseInt(p, end), c.vn.size() / 3, &Corner::vn);
+                            p = fieldEnd(p, end);
+                        }
+                        else {
+                            corner.vt = fix(parseInt(p, end), c.vt.size() / 2, &Corner::vt);
+                            p = fieldEnd(p, end);
+                            if(p < end && *p == '/') {
+                                ++p;
+                                corner.vn = fix(parseInt(p, end), c.vn.size() / 3, &Corner::vn);
+                                p = fieldEnd(p, end);
+                            }
+                        }
+                    }
+                    c.corners.push_back(corner);
+                    while(p < end && (isSpace(*p) || *p == '\r')) ++p;
+                }
+            }
+            else if(keyword("usemtl", 6)) {
+                Event e = { Event::USEMTL, word(p + 7, end), c.faces.size() };
+                c.events.push_back(e);
+            }
+            else if(keyword("mtllib", 6)) {
+                Event e = { Event::MTLLIB, word(p + 7, end), c.faces.size() };
+                c.events.push_back(e);
+            }
+            else if(keyword("g", 1)) {
+                // The name is the first word after g, if any
+                Event e = { Event::GROUP, word(p + 2, end), c.faces.size() };
+                c.events.push_back(e);
+            }
+            else if(keyword("o", 1)) {
+                Event e = { Event::OBJECT, word(p + 2, end), c.faces.size() };
+                c.events.push_back(e);
+            }
+            // Anything else, tags included, is ignored
+        }
+        c.faces.push_back(c.corners.size());
+    }
+
+    /// Flattens a group the way tinyobj's exportFaceGroupToShape does
+    void exportGroup(Group& g, const std::vector<Corner>& corners, const std::vector<size_t>& faces,
+                     const std::vector<float>& v, const std::vector<float>& vn, const std::vector<float>& vt,
+                     bool triangulate) {
+        tinyobj::mesh_t& mesh = g.mesh;
+        std::unordered_map<Corner, unsigned int, CornerHash> cache;
+        cache.reserve(faces[g.end] - faces[g.begin]);
+
+        const auto vertex = [&](const Corner& i) -> unsigned int {
+            auto found = cache.find(i);
+            if(found != cache.end()) return found->second;
+
+            if(i.v < 0 || (size_t)i.v * 3 + 2 >= v.size()) {
+                g.bad_index = true;
+                return 0;
+            }
+            mesh.positions.insert(mesh.positions.end(), &v[(size_t)i.v * 3], &v[(size_t)i.v * 3] + 3);
+            if(i.vn >= 0 && (size_t)i.vn * 3 + 2 < vn.size())
+                mesh.normals.insert(mesh.normals.end(), &vn[(size_t)i.vn * 3], &vn[(size_t)i.vn * 3] + 3);
+            if(i.vt >= 0 && (size_t)i.vt * 2 + 1 < vt.size())
+                mesh.texcoords.insert(mesh.texcoords.end(), &vt[(size_t)i.vt * 2], &vt[(size_t)i.vt * 2] + 2);
+
+            const unsigned int idx = mesh.positions.size() / 3 - 1;
+            cache.insert(std::make_pair(i, idx));
+            return idx;
+        };
+
+        for(size_t f = g.begin; f < g.end; ++f) {
+            const Corner* face = &corners[faces[f]];
+            const size_t n = faces[f + 1] - faces[f];
+
+            if(triangulate) {
+                // Polygon -> triangle fan conversion
+                for(size_t k = 2; k < n; ++k) {
+                    const unsigned int v0 = vertex(face[0]);
+                    const unsigned int v1 = vertex(face[k - 1]);
+                    const unsigned int v2 = vertex(face[k]);
+                    mesh.indices.push_back(v0);
+                    mesh.indices.push_back(v1);
+                    mesh.indices.push_back(v2);
+                    mesh.num_vertices.push_back(3);
+                    mesh.material_ids.push_back(g.material);
+                }
+            }
+            else {
+                for(size_t k = 0; k < n; ++k) mesh.indices.push_back(vertex(face[k]));
+                mesh.num_vertices.push_back((unsigned char)n);
+                mesh.material_ids.push_back(g.material);
+            }
+        }
+    }
+
+    /// Appends src to dst[offset...], dst must already be big enough
+    template<class T>
+    inline void place(std::vector<T>& dst, size_t offset, const std::vector<T>& src) {
+        std::copy(src.begin(), src.end(), dst.begin() + offset);
+    }
+}
+
+bool FastObj::LoadObj(std::vector<tinyobj::shape_t>& shapes,
+                      std::vector<tinyobj::material_t>& materials,
+                      std::string& err,
+                      const char* filename, const char* mtl_basepath,
+                      bool triangulate) {
+    shapes.clear();
+
+    MappedFile file;
+    if(!file.open(filename)) {
+        // Empty files can not be mapped, but are still valid
+        QFileInfo info(filename);
+        if(info.exists() && info.size() == 0) return true;
+        err = std::string("Cannot open file [") + filename + "]\n";
+        return false;
+    }
+
+    ThreadPool& pool = ThreadPool::global();
+    const char* const data = (const char*)file.data();
+    const size_t size = file.size();
+
+    // Split into chunks of whole lines
+    const size_t count = std::max<size_t>(1, std::min<size_t>((pool.size() + 1) * 4, size / MIN_CHUNK));
+    std::vector<Chunk> chunks(count);
+    const char* at = data;
+    for(size_t x = 0; x < count; ++x) {
+        const char* end = data + size * (x + 1) / count;
+        if(end < at) end = at;
+        if(x + 1 < count) {
+            const char* newline = (const char*)std::memchr(end, '\n', data + size - end);
+            end = newline ? newline + 1 : data + size;
+        }
+        chunks[x].begin = at;
+        chunks[x].end = end;
+        at = end;
+    }
+
+    pool.parallelFor(0, count, [&chunks](size_t i) { parseChunk(chunks[i]); });
+
+    // Where each chunk's data goes in the whole file
+    size_t v_count = 0, vn_count = 0, vt_count = 0, corner_count = 0, face_count = 0;
+    for(auto&& c : chunks) {
+        c.v_base = v_count / 3;
+        c.vn_base = vn_count / 3;
+        c.vt_base = vt_count / 2;
+        c.corner_base = corner_count;
+        c.face_base = face_count;
+        v_count += c.v.size();
+        vn_count += c.vn.size();
+        vt_count += c.vt.size();
+        corner_count += c.corners.size();
+        face_count += c.faces.size() - 1;
+    }
+
+    std::vector<float> v(v_count), vn(vn_count), vt(vt_count);
+    std::vector<Corner> corners(corner_count);
+    std::vector<size_t> faces(face_count + 1);
+    faces[face_count] = corner_count;
+
+    pool.parallelFor(0, count, [&](size_t i) {
+        Chunk& c = chunks[i];
+        for(auto&& r : c.relative) {
+            const size_t base = r.field == &Corner::v ? c.v_base : r.field == &Corner::vn ? c.vn_base : c.vt_base;
+            c.corners[r.corner].*r.field += (int)base;
+        }
+        place(v, c.v_base * 3, c.v);
+        place(vn, c.vn_base * 3, c.vn);
+        place(vt, c.vt_base * 2, c.vt);
+        place(corners, c.corner_base, c.corners);
+        for(size_t f = 0; f + 1 < c.faces.size(); ++f)
+            faces[c.face_base + f] = c.faces[f] + c.corner_base;
+
+        // Only the events are still needed
+        std::vector<float>().swap(c.v);
+        std::vector<float>().swap(c.vn);
+        std::vector<float>().swap(c.vt);
+        std::vector<Corner>().swap(c.corners);
+    });
+
+    // Replay the non geometry lines in order to work out the groups and shapes
+    std::vector<Group> groups;
+    std::vector<Shape> out;
+    std::map<std::string, int> material_map;
+    tinyobj::MaterialFileReader readMaterials(mtl_basepath ? mtl_basepath : "");
+
+    Shape current;
+    std::string name;
+    int material = -1;
+    size_t group_begin = 0;
+
+    const auto flush = [&](size_t face) {
+        if(face == group_begin) return false;
+        Group g;
+        g.begin = group_begin;
+        g.end = face;
+        g.material = material;
+        g.bad_index = false;
+        current.groups.push_back(groups.size());
+        current.name = name;
+        groups.push_back(std::move(g));
+        return true;
+    };
+
+    for(auto&& c : chunks) {
+        for(auto&& e : c.events) {
+            const size_t face = c.face_base + e.face;
+            switch(e.kind) {
+            case Event::USEMTL: {
+                auto found = material_map.find(e.name);
+                const int id = (found != material_map.end()) ? found->second : -1;
+                if(id != material) {
+                    flush(face);
+                    group_begin = face;
+                    material = id;
+                }
+                break;
+            }
+            case Event::GROUP:
+            case Event::OBJECT:
+                if(flush(face)) out.push_back(current);
+                current = Shape();
+                group_begin = face;
+                name = e.name;
+                break;
+            case Event::MTLLIB: {
+                std::string err_mtl;
+                const bool ok = readMaterials(e.name, materials, material_map, err_mtl);
+                err += err_mtl;
+                // A missing or broken .mtl fails the load, as it does in tinyobj
+                if(!ok) return false;
+                break;
+            }
+            }
+        }
+    }
+    if(flush(face_count)) out.push_back(current);
+
+    pool.parallelFor(0, groups.size(), [&](size_t i) {
+        exportGroup(groups[i], corners, faces, v, vn, vt, triangulate);
+    });
+
+    for(auto&& g : groups) {
+        if(g.bad_index) {
+            err += std::string("Face refers to a missing vertex in [") + filename + "]\n";
+            return false;
+        }
+    }
+
+    // Stitch each shape's groups together, indices continue from the previous group
+    struct Placement { size_t shape, positions, normals, texcoords, indices, faces; };
+    std::vector<Placement> placements(groups.size());
+    shapes.resize(out.size());
+    for(size_t s = 0; s < out.size(); ++s) {
+        shapes[s].name = out[s].name;
+        tinyobj::mesh_t& mesh = shapes[s].mesh;
+        size_t positions = 0, normals = 0, texcoords = 0, indices = 0, face_total = 0;
+        for(size_t i : out[s].groups) {
+            const tinyobj::mesh_t& m = groups[i].mesh;
+            Placement p = { s, positions, normals, texcoords, indices, face_total };
+            placements[i] = p;
+            positions += m.positions.size();
+            normals += m.normals.size();
+            texcoords += m.texcoords.size();
+            indices += m.indices.size();
+            face_total += m.num_vertices.size();
+        }
+        mesh.positions.resize(positions);
+        mesh.normals.resize(normals);
+        mesh.texcoords.resize(texcoords);
+        mesh.indices.resize(indices);
+        mesh.num_vertices.resize(face_total);
+        mesh.material_ids.resize(face_total);
+    }
+
+    std::vector<size_t> used;
+    for(auto&& s : out) used.insert(used.end(), s.groups.begin(), s.groups.end());
+
+    pool.parallelFor(0, used.size(), [&](size_t x) {
+        const size_t i = used[x];
+        const Placement& p = placements[i];
+        tinyobj::mesh_t& m = groups[i].mesh;
+        tinyobj::mesh_t& mesh = shapes[p.shape].mesh;
+
+        const unsigned int offset = p.positions / 3;
+        for(auto&& index : m.indices) index += offset;
+
+        place(mesh.positions, p.positions, m.positions);
+        place(mesh.normals, p.normals, m.normals);
+        place(mesh.texcoords, p.texcoords, m.texcoords);
+        place(mesh.indices, p.indices, m.indices);
+        place(mesh.num_vertices, p.faces, m.num_vertices);
+        place(mesh.material_ids, p.faces, m.material_ids);
+        m = tinyobj::mesh_t();
+    });
+
+    return true;
+}
@@ -0,0 +1,47 @@
+#include "framestats.h"
+
+#include <algorithm>
+#include <cstdio>
+
+const size_t FrameStats::MAX_SAMPLES;
+
+namespace {
+    typedef std::chrono::duration<double, std::milli> Ms;
+
+    void push(std::vector<double>& samples, double value) {
+        if(samples.size() < FrameStats::MAX_SAMPLES) samples.push_back(value);
+    }
+
+    void printRow(const char* name, std::vector<double> samples) {
+        if(samples.empty()) {
+            printf("  %-8s %8s\n", name, "-");
+            return;
+        }
+        std::sort(samples.begin(), samples.end());
+        double sum = 0.0;
+        for(auto&& i : samples) sum += i;
+        printf("  %-8s %8zu %8.2f %8.2f %8.2f\n", name, samples.size(), sum / samples.size(),
+               samples[samples.size() / 2], samples[samples.size() * 99 / 100]);
+    }
+}
+
+void FrameStats::add(double draw, Clock::time_point presented, Clock::time_point input) {
+    std::lock_guard<std::mutex> guard(lock);
+    push(draw_ms, draw);
+    if(last_presented != Clock::time_point()) push(interval_ms, Ms(presented - last_presented).count());
+    last_presented = presented;
+
+    if(input != Clock::time_point() && input != last_input) {
+        push(latency_ms, Ms(presented - input).count());
+        last_input = input;
+    }
+}
+
+void FrameStats::print(const char* title) const {
+    std::lock_guard<std::mutex> guard(lock);
+    printf("%s:\n", title);
+    printf("  %-8s %8s %8s %8s %8s\n", "ms", "frames", "mean", "median", "99th");
+    printRow("draw", draw_ms);
+    printRow("interval", interval_ms);
+    printRow("latency", latency_ms);
+}
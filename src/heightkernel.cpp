@@ -0,0 +1,26 @@
+#include "heightkernel.h"
+
+#include <glm/gtc/noise.hpp>
+
+void HeightKernel::rowScalar(uint32_t x, uint32_t column, uint32_t n, float* out) {
+    for(uint32_t y = column; y < column + n; ++y) {
+        float& i = out[y - column];
+        i = 0;
+        i += glm::simplex(glm::vec2(x / 8.0f, y / 8.0f)) / 4.0f;
+        i += glm::simplex(glm::vec2(x / 4.0f, y / 4.0f)) / 2.0f;
+        i += glm::simplex(glm::vec2(x / 2.0f, y / 2.0f));
+        i += glm::simplex(glm::vec3(x * 2.0f, y * 2.0f, x * y / 10.0f)) * 4.0f;
+    }
+}
+
+HeightKernel::RowFunction HeightKernel::heightRow() {
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    static const RowFunction best = __builtin_cpu_supports("avx2") ? rowAVX2 :
+                                    __builtin_cpu_supports("sse2") ? rowSSE2 : rowScalar;
+    return best;
+#elif defined(_M_X64)
+    return rowSSE2;
+#else
+    return rowScalar;
+#endif
+}
@@ -0,0 +1,62 @@
+#include "heightkernel.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+// Everything from here to the end of the file is built for AVX2, and only
+// called after checking the CPU has it. The whole region is retargeted rather
+// than individual functions so implicit members of F8 are built for AVX2 too.
+// FMA is left off so the results round the same as the other kernels.
+#if defined(__clang__)
+#pragma clang attribute push (__attribute__((target("avx2"))), apply_to = function)
+#else
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+#include <immintrin.h>
+
+namespace {
+    /// Eight floats
+    struct F8 {
+        enum { WIDTH = 8 };
+        __m256 v;
+
+        F8(__m256 v) : v(v) {}
+        explicit F8(float f) : v(_mm256_set1_ps(f)) {}
+
+        static inline F8 load(const float* p) { return F8(_mm256_load_ps(p)); }
+        inline void store(float* p) const { _mm256_store_ps(p, v); }
+    };
+
+    inline F8 operator+(F8 a, F8 b) { return F8(_mm256_add_ps(a.v, b.v)); }
+    inline F8 operator-(F8 a, F8 b) { return F8(_mm256_sub_ps(a.v, b.v)); }
+    inline F8 operator*(F8 a, F8 b) { return F8(_mm256_mul_ps(a.v, b.v)); }
+    inline F8 operator/(F8 a, F8 b) { return F8(_mm256_div_ps(a.v, b.v)); }
+    inline F8 vmin(F8 a, F8 b) { return F8(_mm256_min_ps(a.v, b.v)); }
+    inline F8 vmax(F8 a, F8 b) { return F8(_mm256_max_ps(a.v, b.v)); }
+    inline F8 vabs(F8 a) { return F8(_mm256_andnot_ps(_mm256_set1_ps(-0.0f), a.v)); }
+    inline F8 vfloor(F8 a) { return F8(_mm256_floor_ps(a.v)); }
+    inline F8 vge(F8 a, F8 b) { return F8(_mm256_and_ps(_mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ), _mm256_set1_ps(1.0f))); }
+    inline F8 vgt(F8 a, F8 b) { return F8(_mm256_and_ps(_mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ), _mm256_set1_ps(1.0f))); }
+}
+
+#define NOISE_TARGET
+#include "simplexkernel.h"
+
+void HeightKernel::rowAVX2(uint32_t row, uint32_t column, uint32_t n, float* out) {
+    heightOctaves<F8>(row, column, n, out);
+}
+
+#if defined(__clang__)
+#pragma clang attribute pop
+#else
+#pragma GCC pop_options
+#endif
+
+#else
+
+void HeightKernel::rowAVX2(uint32_t row, uint32_t column, uint32_t n, float* out) {
+    rowSSE2(row, column, n, out);
+}
+
+#endif
@@ -0,0 +1,49 @@
+#include "heightkernel.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+
+namespace {
+    /// Four floats, SSE2 is part of every x86-64 CPU so this needs no target
+    struct F4 {
+        enum { WIDTH = 4 };
+        __m128 v;
+
+        F4(__m128 v) : v(v) {}
+        explicit F4(float f) : v(_mm_set1_ps(f)) {}
+
+        static inline F4 load(const float* p) { return F4(_mm_load_ps(p)); }
+        inline void store(float* p) const { _mm_store_ps(p, v); }
+    };
+
+    inline F4 operator+(F4 a, F4 b) { return F4(_mm_add_ps(a.v, b.v)); }
+    inline F4 operator-(F4 a, F4 b) { return F4(_mm_sub_ps(a.v, b.v)); }
+    inline F4 operator*(F4 a, F4 b) { return F4(_mm_mul_ps(a.v, b.v)); }
+    inline F4 operator/(F4 a, F4 b) { return F4(_mm_div_ps(a.v, b.v)); }
+    inline F4 vmin(F4 a, F4 b) { return F4(_mm_min_ps(a.v, b.v)); }
+    inline F4 vmax(F4 a, F4 b) { return F4(_mm_max_ps(a.v, b.v)); }
+    inline F4 vabs(F4 a) { return F4(_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)); }
+    inline F4 vge(F4 a, F4 b) { return F4(_mm_and_ps(_mm_cmpge_ps(a.v, b.v), _mm_set1_ps(1.0f))); }
+    inline F4 vgt(F4 a, F4 b) { return F4(_mm_and_ps(_mm_cmpgt_ps(a.v, b.v), _mm_set1_ps(1.0f))); }
+
+    /// SSE2 has no floor, truncate and correct negative values (exact for |a| < 2^31)
+    inline F4 vfloor(F4 a) {
+        __m128 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+        return F4(_mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a.v), _mm_set1_ps(1.0f))));
+    }
+}
+
+#define NOISE_TARGET
+#include "simplexkernel.h"
+
+void HeightKernel::rowSSE2(uint32_t row, uint32_t column, uint32_t n, float* out) {
+    heightOctaves<F4>(row, column, n, out);
+}
+
+#else
+
+void HeightKernel::rowSSE2(uint32_t row, uint32_t column, uint32_t n, float* out) {
+    rowScalar(row, column, n, out);
+}
+
+#endif
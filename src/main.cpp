@@ -4,7 +4,15 @@
 #include <QMainWindow>
 #include <QSurfaceFormat>
 
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
 #include "raceview.h"
+#include "racewindow.h"
+#include "threadpool.h"
 
 /* Matthew Conover
  *
@@ -21,6 +29,24 @@
  * I can't belive the class is over. Wow.
  */
 int main(int argc, char** argv) {
+    // Loading, texture generation and culling all run as jobs. The GUI thread
+    // helps whenever it waits on them, so it keeps a core of its own.
+    ThreadPool::start(std::max(2u, std::thread::hardware_concurrency()) - 1);
+
+    // --tick-hz N sets how often the simulation steps, --max-fps and
+    // --background-fps cap the frame rate with and without focus, and
+    // --host widget draws through a QOpenGLWidget instead of a window
+    unsigned tick_hz = Simulation::DEFAULT_HZ;
+    double max_fps = 0.0;
+    double background_fps = RaceSession::BACKGROUND_FPS;
+    bool widget_host = false;
+    for(int x = 1; x + 1 < argc; ++x) {
+        if(std::strcmp(argv[x], "--tick-hz") == 0) tick_hz = std::strtoul(argv[x + 1], nullptr, 10);
+        else if(std::strcmp(argv[x], "--host") == 0) widget_host = std::strcmp(argv[x + 1], "widget") == 0;
+        else if(std::strcmp(argv[x], "--max-fps") == 0) max_fps = std::strtod(argv[x + 1], nullptr);
+        else if(std::strcmp(argv[x], "--background-fps") == 0) background_fps = std::strtod(argv[x + 1], nullptr);
+    }
+
     QApplication app(argc, argv);
 
     // Create the main window and set title.
@@ -38,9 +64,20 @@ int main(int argc, char** argv) {
     // Container for the OpenGL view
     QHBoxLayout* container = new QHBoxLayout;
 
-    // Uncomment and replace with a class that is a subclass of GLViewQt
-    RaceView* glWindow = new RaceView;
-    container->addWidget(glWindow);
+    // The window presents from the render thread, the widget is kept to compare against
+    RaceView* view = nullptr;
+    RaceWindow* window = nullptr;
+    if(widget_host) {
+        view = new RaceView(tick_hz);
+        view->setFrameCaps(max_fps, background_fps);
+        container->addWidget(view);
+    } else {
+        window = new RaceWindow(tick_hz);
+        window->setFrameCaps(max_fps, background_fps);
+        QWidget* holder = QWidget::createWindowContainer(window);
+        holder->setFocusPolicy(Qt::FocusPolicy::StrongFocus);
+        container->addWidget(holder);
+    }
 
     // Create a widget, and add the container to the widget
     QWidget* w = new QWidget;
@@ -49,7 +86,22 @@ int main(int argc, char** argv) {
     // Set the widget as the main widget for the QMainWindow
     mainWindow.setCentralWidget(w);
 
+    // The window container has no size hint of its own
+    if(window != nullptr) mainWindow.resize(800, 600);
+
     // Make the main window visible
     mainWindow.show();
-    return app.exec();
+    const int result = app.exec();
+
+    if(view != nullptr) view->stats().print("Frames (widget)");
+    else window->stats().print("Frames (window)");
+
+    const ThreadPool::Stats stats = ThreadPool::global().stats();
+    printf("Workers over %.1f s:\n", stats.elapsed_ms / 1000.0);
+    for(size_t x = 0; x < stats.workers.size(); ++x) {
+        const ThreadPool::WorkerStats& w = stats.workers[x];
+        printf("  %2zu %8lu jobs %6lu stolen %5.1f%% busy\n", x, (unsigned long)w.jobs, (unsigned long)w.steals,
+               100.0 * w.busy_ms / stats.elapsed_ms);
+    }
+    return result;
 }
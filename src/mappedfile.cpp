@@ -0,0 +1,27 @@
+#include "mappedfile.h"
+
+bool MappedFile::open(const std::string& file_name) {
+    close();
+
+    file.setFileName(file_name.c_str());
+    if(!file.open(QIODevice::ReadOnly)) return false;
+
+    // Mapping an empty file fails, so there is nothing to map
+    const qint64 size = file.size();
+    uchar* data = size > 0 ? file.map(0, size) : nullptr;
+    if(data == nullptr) {
+        file.close();
+        return false;
+    }
+
+    m_data = data;
+    m_size = size;
+    return true;
+}
+
+void MappedFile::close() {
+    if(m_data != nullptr) file.unmap(const_cast<uchar*>(m_data));
+    if(file.isOpen()) file.close();
+    m_data = nullptr;
+    m_size = 0;
+}
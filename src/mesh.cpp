@@ -14,3 +14,14 @@ void Mesh::destroy() {
     gl->glDeleteVertexArrays(1, &m_vao);
     m_vao = 0;
 }
+
+void Mesh::setBounds(const GLfloat* positions, GLuint vertices) {
+    m_has_bounds = vertices > 0;
+    if(!m_has_bounds) return;
+    m_min = m_max = glm::vec3(positions[0], positions[1], positions[2]);
+    for(GLuint v = 1; v < vertices; ++v) {
+        glm::vec3 p(positions[3 * v], positions[3 * v + 1], positions[3 * v + 2]);
+        m_min = glm::min(m_min, p);
+        m_max = glm::max(m_max, p);
+    }
+}
@@ -0,0 +1,150 @@
+#include "meshcache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include "sourcestamp.h"
+
+namespace {
+    const char     MAGIC[4] = { 'R', 'M', 'S', 'H' };
+    /// Version of the file layout, bump whenever it or the data stored changes
+    const uint32_t FORMAT_VERSION = 3;
+    /// Every array starts on a multiple of this
+    const size_t   SECTION_ALIGNMENT = 16;
+
+    struct Header {
+        char     magic[4];
+        uint32_t version;
+        /// Identifies the source file the cache was built from
+        SourceStamp source;
+        uint32_t vertices;
+        uint32_t indices;
+        uint32_t parts;
+        uint32_t materials;
+        float    min[3];
+        float    max[3];
+    };
+
+    /// Le, Ka, Kd, Ks and shine
+    const size_t MATERIAL_FLOATS = 13;
+
+    /// Byte offsets of each array, in file order
+    struct Layout {
+        size_t positions, normals, indices, parts, materials, end;
+
+        explicit Layout(const Header& h) {
+            const auto next = [](size_t offset, size_t bytes) {
+                offset += bytes;
+                return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+            };
+            positions = next(0, sizeof(Header));
+            normals   = next(positions, (size_t)h.vertices * 3 * sizeof(GLfloat));
+            indices   = next(normals,   (size_t)h.vertices * 3 * sizeof(GLfloat));
+            parts     = next(indices,   (size_t)h.indices * sizeof(GLuint));
+            materials = next(parts,     (size_t)h.parts * sizeof(MeshCache::Part));
+            end       = materials + (size_t)h.materials * MATERIAL_FLOATS * sizeof(float);
+        }
+    };
+}
+
+std::string MeshCache::pathFor(const std::string& source) {
+    return source + ".meshcache";
+}
+
+bool MeshCache::load(const std::string& source, View& view) {
+    MappedFile& file = view.file;
+    if(!file.open(pathFor(source))) return false;
+
+    Header head;
+    if(file.size() < sizeof(head)) return false;
+    std::memcpy(&head, file.data(), sizeof(head));
+    if(!std::equal(MAGIC, MAGIC + 4, head.magic) || head.version != FORMAT_VERSION) return false;
+
+    if(!head.source.matches(source)) return false;
+
+    const Layout layout(head);
+    if(layout.end != file.size()) return false;
+
+    const uint8_t* base = file.data();
+    view.vertex_count = head.vertices;
+    view.index_count = head.indices;
+    view.part_count = head.parts;
+    view.positions = reinterpret_cast<const GLfloat*>(base + layout.positions);
+    view.normals = reinterpret_cast<const GLfloat*>(base + layout.normals);
+    view.indices = reinterpret_cast<const GLuint*>(base + layout.indices);
+    view.parts = reinterpret_cast<const Part*>(base + layout.parts);
+    view.min = glm::vec3(head.min[0], head.min[1], head.min[2]);
+    view.max = glm::vec3(head.max[0], head.max[1], head.max[2]);
+
+    // A corrupt index or range would make GL read outside the buffers
+    for(uint32_t x = 0; x < head.parts; ++x) {
+        const Part& p = view.parts[x];
+        if(p.start > head.indices || p.count > head.indices - p.start) return false;
+    }
+    if(std::any_of(view.indices, view.indices + head.indices,
+                   [&head](GLuint i) { return i >= head.vertices; }))
+        return false;
+
+    view.materials.clear();
+    const float* m = reinterpret_cast<const float*>(base + layout.materials);
+    for(uint32_t x = 0; x < head.materials; ++x, m += MATERIAL_FLOATS) {
+        view.materials.push_back(Material(
+            glm::vec3(m[0], m[1], m[2]),
+            glm::vec3(m[3], m[4], m[5]),
+            glm::vec3(m[6], m[7], m[8]),
+            glm::vec3(m[9], m[10], m[11]),
+            m[12]
+        ));
+    }
+    return true;
+}
+
+bool MeshCache::save(const std::string& source, const MeshData& data) {
+    if(data.positions.size() != data.normals.size() || data.positions.size() % 3 != 0) return false;
+
+    Header head;
+    std::memset(&head, 0, sizeof(head));
+    std::copy(MAGIC, MAGIC + 4, head.magic);
+    head.version = FORMAT_VERSION;
+    if(!SourceStamp::of(source, head.source)) return false;
+    head.vertices = data.positions.size() / 3;
+    head.indices = data.indices.size();
+    head.parts = data.parts.size();
+    head.materials = data.materials.size();
+    for(int x = 0; x < 3; ++x) {
+        head.min[x] = data.min[x];
+        head.max[x] = data.max[x];
+    }
+
+    std::vector<float> materials;
+    for(auto&& i : data.materials) {
+        const glm::vec3* v[4] = { &i.Le, &i.Ka, &i.Kd, &i.Ks };
+        for(auto&& j : v) materials.insert(materials.end(), { j->x, j->y, j->z });
+        materials.push_back(i.shine);
+    }
+
+    // Lay the sections out in one buffer, padding included, then write it at once
+    const Layout layout(head);
+    std::vector<uint8_t> out(layout.end, 0);
+    const auto place = [&out](size_t offset, const void* src, size_t bytes) {
+        if(bytes > 0) std::memcpy(&out[offset], src, bytes);
+    };
+    place(0, &head, sizeof(head));
+    place(layout.positions, data.positions.data(), data.positions.size() * sizeof(GLfloat));
+    place(layout.normals, data.normals.data(), data.normals.size() * sizeof(GLfloat));
+    place(layout.indices, data.indices.data(), data.indices.size() * sizeof(GLuint));
+    place(layout.parts, data.parts.data(), data.parts.size() * sizeof(Part));
+    place(layout.materials, materials.data(), materials.size() * sizeof(float));
+
+    // Written to a temporary first so a crash never leaves a half written cache
+    const std::string path = pathFor(source);
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream file(tmp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!file || !file.write((const char*)&out[0], out.size())) return false;
+    }
+    std::remove(path.c_str());
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
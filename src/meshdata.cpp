@@ -0,0 +1,14 @@
+#include "meshdata.h"
+
+MeshOpt::Report MeshData::optimize() {
+    if(positions.empty()) {
+        MeshOpt::Report none = { 0, 0, 0.0f, 0.0f };
+        return none;
+    }
+
+    std::vector<MeshOpt::Stream> streams;
+    const MeshOpt::Stream all[] = { { &positions, 3 }, { &normals, 3 }, { &colors, 4 }, { &texcoords, 2 } };
+    for(auto&& s : all)
+        if(!s.data->empty()) streams.push_back(s);
+    return MeshOpt::optimize(indices, streams);
+}
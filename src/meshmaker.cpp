@@ -3,14 +3,14 @@
 
 #include "meshmaker.h"
 
-MultiEntity* MeshMaker::cappedCone(const SceneEntity& e) {
+MultiEntity* MeshMaker::cappedCone(Arena* arena, const SceneEntity& e) {
     Cone* cone = std::dynamic_pointer_cast<Cone>(e.mesh).get();
     if(cone == nullptr) throw std::invalid_argument("drawCappedCone expected SceneEntity containing a mesh of type Cone");
 
-    auto mesh = std::shared_ptr<Mesh>(
-        new Disk( cone->getRadius(), cone->getSlices() ) // Has same radius and num slices
+    std::shared_ptr<Mesh> mesh = shareIn<Disk>(arena,
+        cone->getRadius(), cone->getSlices() // Has same radius and num slices
     );
-    auto transform = std::make_shared<glm::mat4>(
+    auto transform = pooled<glm::mat4>(
         glm::rotate(*e.transform, glm::pi<float>(), glm::vec3(1, 0, 0))
     );
 
@@ -23,22 +23,22 @@ MultiEntity* MeshMaker::cappedCone(const SceneEntity& e) {
     );
 }
 
-MultiEntity* MeshMaker::cappedCylider(const SceneEntity& e) {
+MultiEntity* MeshMaker::cappedCylider(Arena* arena, const SceneEntity& e) {
     Cylinder* cylinder = std::dynamic_pointer_cast<Cylinder>(e.mesh).get();
     if(cylinder == nullptr) throw std::invalid_argument("drawCappedCylider expected SceneEntity containing a mesh of type Cylinder");
 
     // Both will use the same mesh
-    auto mesh = std::shared_ptr<Mesh>(
+    std::shared_ptr<Mesh> mesh = shareIn<Disk>(arena,
         // Has same radius and num slices
-        new Disk( cylinder->getRadius(), cylinder->getSlices() )
+        cylinder->getRadius(), cylinder->getSlices()
     );
 
-    auto transform1 = std::make_shared<glm::mat4>(
+    auto transform1 = pooled<glm::mat4>(
         // The bottom cap just needs to be flipped
         glm::rotate(*e.transform, glm::pi<float>(), glm::vec3(1, 0, 0))
     );
 
-    auto transform2 = std::make_shared<glm::mat4>(
+    auto transform2 = pooled<glm::mat4>(
         // The top cap just needs to be translated
         glm::translate(*e.transform, glm::vec3(0, 0, cylinder->getHeight()))
     );
@@ -59,21 +59,24 @@ MultiEntity* MeshMaker::cappedCylider(const SceneEntity& e) {
     );
 }
 
-MultiEntity* MeshMaker::tree(Shader& s, float h, std::shared_ptr<Material> trunk, std::shared_ptr<Material> top) {
-    MultiEntity* tree = MeshMaker::cappedCone( SceneEntity(s, std::make_shared<Cone>(1.0f, h / 1.5f, 16), nullptr, top) );
-    auto transform = std::make_shared<glm::mat4>(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, h / -3.0f)));
-    tree = new MultiEntity(s, std::make_shared<Cylinder>(0.4f, h / 3.0f, 8), transform, trunk, tree);
+MultiEntity* MeshMaker::tree(Arena* arena, Shader& s, float h, std::shared_ptr<Material> trunk,
+                             std::shared_ptr<Material> top) {
+    MultiEntity* tree = MeshMaker::cappedCone(arena,
+        SceneEntity(s, shareIn<Cone>(arena, 1.0f, h / 1.5f, 16), nullptr, top));
+    auto transform = pooled<glm::mat4>(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, h / -3.0f)));
+    tree = new MultiEntity(s, shareIn<Cylinder>(arena, 0.4f, h / 3.0f, 8), transform, trunk, tree);
     tree->objtowld = // Move group so it is correctly oriented
         glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, h / 3.0f, 0.0f)) *                  // Move it out of the ground
         glm::rotate(glm::mat4(1.0f), glm::half_pi<float>(), glm::vec3(-1.0f, 0.0f, 0.0f));  // Make it face upwards
     return tree;
 }
 
-MultiEntity* MeshMaker::lamp(Shader& s, float h, std::shared_ptr<Material> post, std::shared_ptr<Material> top) {
+MultiEntity* MeshMaker::lamp(Arena* arena, Shader& s, float h, std::shared_ptr<Material> post,
+                             std::shared_ptr<Material> top) {
 
-    MultiEntity* lamp = new MultiEntity(s, std::make_shared<Cube>(0.5f), nullptr, top);
-    auto transform = std::make_shared<glm::mat4>(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.5f - h))); //TODO: this, left off here
-    lamp = new MultiEntity(s, std::make_shared<Cylinder>(0.1f, h - 0.5f, 8), transform, post, lamp);
+    MultiEntity* lamp = new MultiEntity(s, shareIn<Cube>(arena, 0.5f), nullptr, top);
+    auto transform = pooled<glm::mat4>(glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.0f, 0.5f - h))); //TODO: this, left off here
+    lamp = new MultiEntity(s, shareIn<Cylinder>(arena, 0.1f, h - 0.5f, 8), transform, post, lamp);
     lamp->objtowld = // Move group so it is correctly oriented
         glm::rotate(glm::mat4(1.0f), glm::half_pi<float>(), glm::vec3(-1.0f, 0.0f, 0.0f));  // Make it face upwards
     return lamp;
@@ -0,0 +1,340 @@
+#include "meshopt.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <glm/glm.hpp>
+#include <unordered_map>
+
+namespace {
+    const GLuint UNUSED = ~0u;
+
+    /// Simulates a FIFO vertex cache by stamping each vertex with when it was last loaded
+    struct Fifo {
+        std::vector<unsigned> stamp;
+        unsigned time;
+        unsigned size;
+
+        Fifo(GLuint vertices, unsigned cache_size) : stamp(vertices, 0), time(cache_size + 1), size(cache_size) {}
+
+        /// @return 1 on a miss
+        inline unsigned access(GLuint v) {
+            if(time - stamp[v] <= size) return 0;
+            stamp[v] = time++;
+            return 1;
+        }
+
+        inline unsigned access(const GLuint* triangle) {
+            return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+        }
+
+        /// Evicts everything
+        inline void flush() { time += size; }
+    };
+
+    /// Hashes and compares vertices by every attribute, bit for bit
+    struct VertexKey {
+        const std::vector<MeshOpt::Stream>* streams;
+
+        size_t operator()(GLuint v) const {
+            uint64_t h = 14695981039346656037ULL;
+            for(auto&& s : *streams) {
+                const GLfloat* data = s.data->data() + (size_t)v * s.components;
+                for(unsigned c = 0; c < s.components; ++c) {
+                    uint32_t bits;
+                    std::memcpy(&bits, data + c, sizeof(bits));
+                    h ^= bits;
+                    h *= 1099511628211ULL;
+                }
+            }
+            return (size_t)h;
+        }
+
+        bool operator()(GLuint a, GLuint b) const {
+            for(auto&& s : *streams) {
+                const GLfloat* data = s.data->data();
+                if(std::memcmp(data + (size_t)a * s.components, data + (size_t)b * s.components,
+                               s.components * sizeof(GLfloat)) != 0)
+                    return false;
+            }
+            return true;
+        }
+    };
+
+    /// Moves vertex v to remap[v] in every stream, remap must never move a vertex up
+    void compact(const std::vector<MeshOpt::Stream>& streams, const std::vector<GLuint>& remap, GLuint vertices) {
+        for(auto&& s : streams) {
+            std::vector<GLfloat>& data = *s.data;
+            for(GLuint v = 0; v < remap.size(); ++v) {
+                if(remap[v] == UNUSED) continue;
+                std::copy(data.begin() + (size_t)v * s.components, data.begin() + (size_t)(v + 1) * s.components,
+                          data.begin() + (size_t)remap[v] * s.components);
+            }
+            data.resize((size_t)vertices * s.components);
+        }
+    }
+
+    inline GLuint vertexCount(const std::vector<MeshOpt::Stream>& streams) {
+        return streams.empty() ? 0 : streams[0].data->size() / streams[0].components;
+    }
+}
+
+float MeshOpt::acmr(const GLuint* indices, size_t count, GLuint vertices, unsigned cache_size) {
+    if(count < 3) return 0.0f;
+
+    Fifo cache(vertices, cache_size);
+    size_t misses = 0;
+    for(size_t x = 0; x + 2 < count; x += 3) misses += cache.access(indices + x);
+    return (float)misses / (float)(count / 3);
+}
+
+GLuint MeshOpt::weld(std::vector<GLuint>& indices, const std::vector<Stream>& streams) {
+    const GLuint vertices = vertexCount(streams);
+
+    VertexKey key = { &streams };
+    std::unordered_map<GLuint, GLuint, VertexKey, VertexKey> first(vertices * 2, key, key);
+
+    // A vertex keeps its place relative to the others, duplicates take the first one's
+    std::vector<GLuint> remap(vertices);
+    std::vector<GLuint> moved(vertices, UNUSED);
+    GLuint next = 0;
+    for(GLuint v = 0; v < vertices; ++v) {
+        auto found = first.insert(std::make_pair(v, next));
+        if(found.second) moved[v] = next++;
+        remap[v] = found.first->second;
+    }
+
+    if(next != vertices) {
+        for(auto&& i : indices) i = remap[i];
+        compact(streams, moved, next);
+    }
+    return next;
+}
+
+void MeshOpt::optimizeVertexCache(GLuint* indices, size_t count, GLuint vertices) {
+    const size_t triangles = count / 3;
+    if(triangles < 2) return;
+
+    // Triangles using each vertex
+    std::vector<GLuint> live(vertices, 0);
+    for(size_t x = 0; x < triangles * 3; ++x) ++live[indices[x]];
+
+    std::vector<size_t> offsets(vertices + 1, 0);
+    for(GLuint v = 0; v < vertices; ++v) offsets[v + 1] = offsets[v] + live[v];
+
+    std::vector<GLuint> adjacent(offsets[vertices]);
+    {
+        std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+        for(size_t x = 0; x < triangles * 3; ++x) adjacent[fill[indices[x]]++] = x / 3;
+    }
+
+    std::vector<unsigned> cache_time(vertices, 0);
+    unsigned time = CACHE_SIZE + 1;
+    std::vector<bool> emitted(triangles, false);
+    std::vector<GLuint> dead_end;
+    std::vector<GLuint> candidates;
+    std::vector<GLuint> out;
+    out.reserve(triangles * 3);
+
+    GLuint cursor = 0;
+    GLuint fan = indices[0];
+    while(fan != UNUSED) {
+        // Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for(size_t k = offsets[fan]; k < offsets[fan + 1]; ++k) {
+            const GLuint t = adjacent[k];
+            if(emitted[t]) continue;
+            emitted[t] = true;
+
+            for(unsigned j = 0; j < 3; ++j) {
+                const GLuint v = indices[t * 3 + j];
+                out.push_back(v);
+                dead_end.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if(time - cache_time[v] > CACHE_SIZE) cache_time[v] = time++;
+            }
+        }
+
+        // Prefer the oldest vertex which will still be cached after its fan is emitted
+        fan = UNUSED;
+        int best = -1;
+        for(GLuint v : candidates) {
+            if(live[v] == 0) continue;
+            int priority = 0;
+            if(time - cache_time[v] + 2 * live[v] <= CACHE_SIZE) priority = time - cache_time[v];
+            if(priority > best) {
+                best = priority;
+                fan = v;
+            }
+        }
+
+        // Otherwise go back to a recently used vertex, or any vertex left
+        while(fan == UNUSED && !dead_end.empty()) {
+            const GLuint v = dead_end.back();
+            dead_end.pop_back();
+            if(live[v] > 0) fan = v;
+        }
+        for(; fan == UNUSED && cursor < vertices; ++cursor)
+            if(live[cursor] > 0) fan = cursor;
+    }
+
+    std::copy(out.begin(), out.end(), indices);
+}
+
+void MeshOpt::optimizeOverdraw(GLuint* indices, size_t count, const GLfloat* positions, GLuint vertices,
+                               float threshold) {
+    const size_t triangles = count / 3;
+    if(triangles < 2) return;
+
+    // Hard boundaries are where the cache ordering had to start over anyway
+    std::vector<size_t> hard;
+    {
+        Fifo cache(vertices, CACHE_SIZE);
+        for(size_t t = 0; t < triangles; ++t)
+            if(cache.access(indices + t * 3) == 3 || t == 0) hard.push_back(t);
+        hard.push_back(triangles);
+    }
+
+    // Split further where a fresh cache costs little extra
+    std::vector<size_t> clusters;
+    Fifo cache(vertices, CACHE_SIZE);
+    for(size_t c = 0; c + 1 < hard.size(); ++c) {
+        const size_t begin = hard[c], end = hard[c + 1];
+        size_t misses = 0;
+        cache.flush();
+        for(size_t t = begin; t < end; ++t) misses += cache.access(indices + t * 3);
+        const float target = (float)misses / (float)(end - begin) * threshold;
+
+        size_t start = begin;
+        misses = 0;
+        cache.flush();
+        clusters.push_back(begin);
+        for(size_t t = begin; t + 1 < end; ++t) {
+            misses += cache.access(indices + t * 3);
+            if((float)misses <= target * (float)(t + 1 - start)) {
+                clusters.push_back(t + 1);
+                cache.flush();
+                start = t + 1;
+                misses = 0;
+            }
+        }
+    }
+    clusters.push_back(triangles);
+
+    const auto position = [positions](GLuint v) {
+        return glm::vec3(positions[v * 3 + 0], positions[v * 3 + 1], positions[v * 3 + 2]);
+    };
+
+    // Area weighted centroid of everything
+    glm::vec3 mesh_sum(0.0f);
+    float mesh_area = 0.0f;
+    std::vector<glm::vec3> centroids(clusters.size() - 1), normals(clusters.size() - 1);
+    for(size_t c = 0; c + 1 < clusters.size(); ++c) {
+        glm::vec3 sum(0.0f), plain(0.0f), normal(0.0f);
+        float area = 0.0f;
+        for(size_t t = clusters[c]; t < clusters[c + 1]; ++t) {
+            const glm::vec3 p0 = position(indices[t * 3 + 0]);
+            const glm::vec3 p1 = position(indices[t * 3 + 1]);
+            const glm::vec3 p2 = position(indices[t * 3 + 2]);
+            const glm::vec3 cross = glm::cross(p1 - p0, p2 - p0);
+            const float a = glm::length(cross);
+            const glm::vec3 centre = (p0 + p1 + p2) / 3.0f;
+            sum += centre * a;
+            plain += centre;
+            normal += cross;
+            area += a;
+        }
+        centroids[c] = area > 0.0f ? sum / area : plain / (float)(clusters[c + 1] - clusters[c]);
+        const float length = glm::length(normal);
+        normals[c] = length > 0.0f ? normal / length : glm::vec3(0.0f);
+        mesh_sum += sum;
+        mesh_area += area;
+    }
+    if(mesh_area <= 0.0f) return;
+    const glm::vec3 mesh_centroid = mesh_sum / mesh_area;
+
+    // Clusters facing away from the centre are the likely occluders
+    std::vector<float> keys(centroids.size());
+    std::vector<size_t> order(centroids.size());
+    for(size_t c = 0; c < order.size(); ++c) {
+        keys[c] = glm::dot(centroids[c] - mesh_centroid, normals[c]);
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&keys](size_t a, size_t b) { return keys[a] > keys[b]; });
+
+    std::vector<GLuint> out;
+    out.reserve(triangles * 3);
+    for(size_t c : order)
+        out.insert(out.end(), indices + clusters[c] * 3, indices + clusters[c + 1] * 3);
+    std::copy(out.begin(), out.end(), indices);
+}
+
+void MeshOpt::optimizeVertexFetch(std::vector<GLuint>& indices, const std::vector<Stream>& streams) {
+    const GLuint vertices = vertexCount(streams);
+
+    std::vector<GLuint> remap(vertices, UNUSED);
+    GLuint next = 0;
+    for(auto&& i : indices) {
+        if(remap[i] == UNUSED) remap[i] = next++;
+        i = remap[i];
+    }
+
+    for(auto&& s : streams) {
+        std::vector<GLfloat> out((size_t)next * s.components);
+        for(GLuint v = 0; v < vertices; ++v) {
+            if(remap[v] == UNUSED) continue;
+            std::copy(s.data->begin() + (size_t)v * s.components, s.data->begin() + (size_t)(v + 1) * s.components,
+                      out.begin() + (size_t)remap[v] * s.components);
+        }
+        s.data->swap(out);
+    }
+}
+
+MeshOpt::Report MeshOpt::optimize(std::vector<GLuint>& indices, const std::vector<Stream>& streams,
+                                  const std::vector<Range>& ranges) {
+    Report report;
+    report.vertices_before = vertexCount(streams);
+    report.acmr_before = acmr(indices.data(), indices.size(), report.vertices_before);
+
+    const GLuint vertices = weld(indices, streams);
+
+    std::vector<Range> all = ranges;
+    if(all.empty()) {
+        Range whole = { 0, (GLuint)indices.size() };
+        all.push_back(whole);
+    }
+
+    // Each range is ordered with its own compact numbering, so the work only depends on its size
+    const std::vector<GLfloat>& positions = *streams[0].data;
+    std::vector<GLuint> local(vertices, UNUSED);
+    std::vector<GLuint> global;
+    std::vector<GLuint> triangles;
+    std::vector<GLfloat> points;
+    for(auto&& r : all) {
+        const GLuint count = r.count / 3 * 3;
+        global.clear();
+        points.clear();
+        triangles.assign(indices.begin() + r.start, indices.begin() + r.start + count);
+        for(auto&& i : triangles) {
+            if(local[i] == UNUSED) {
+                local[i] = global.size();
+                global.push_back(i);
+                points.insert(points.end(), positions.begin() + (size_t)i * 3, positions.begin() + (size_t)i * 3 + 3);
+            }
+            i = local[i];
+        }
+
+        optimizeVertexCache(triangles.data(), count, global.size());
+        optimizeOverdraw(triangles.data(), count, points.data(), global.size());
+
+        for(GLuint x = 0; x < count; ++x) indices[r.start + x] = global[triangles[x]];
+        for(GLuint v : global) local[v] = UNUSED;
+    }
+
+    optimizeVertexFetch(indices, streams);
+
+    report.vertices_after = vertexCount(streams);
+    report.acmr_after = acmr(indices.data(), indices.size(), report.vertices_after);
+    return report;
+}
@@ -32,3 +32,17 @@ void MobileEntity::turn(float angle) {
 
     updateMobVals();
 }
+
+glm::mat4 MobileEntity::interpolate(const glm::mat4& a, const glm::mat4& b, float t) {
+    // The columns are u, v, n and the position, as updateMobVals() builds them
+    glm::vec3 n = glm::normalize(glm::mix(glm::vec3(a[2]), glm::vec3(b[2]), t));
+    glm::vec3 u = glm::normalize(glm::cross(glm::mix(glm::vec3(a[1]), glm::vec3(b[1]), t), n));
+    glm::vec3 v = glm::normalize(glm::cross(n, u));
+
+    glm::mat4 m;
+    m[0] = glm::vec4(u, 0);
+    m[1] = glm::vec4(v, 0);
+    m[2] = glm::vec4(n, 0);
+    m[3] = glm::mix(a[3], b[3], t);
+    return m;
+}
@@ -0,0 +1,161 @@
+#include "normalkernel.h"
+
+#include <cstring>
+#include <glm/glm.hpp>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define NORMAL_KERNEL_SSE2
+#endif
+
+namespace {
+    /// The texel at row x, column y, computed the way generateNormalMap always has
+    void texel(uint32_t w, uint32_t h, const uint8_t* height_map, uint32_t x, uint32_t y, uint8_t* out) {
+        glm::vec3 sum(0.0f, 0.0f, 0.0f); //The sum of all the triangle normals
+
+        // Wrap end values xp1 = x plus 1, xm1 = x minus 1
+        // This makes the seams much harder to spot
+        const uint32_t xp1 = (x + 1) % h;
+        const uint32_t yp1 = (y + 1) % w;
+        const uint32_t xm1 = ( (x != 0) ? (x - 1) : (h - 1) );
+        const uint32_t ym1 = ( (y != 0) ? (y - 1) : (w - 1) );
+
+        const auto getHeight = [&](uint32_t a, uint32_t b)->float {
+            return ((float)height_map[a * w + b]) / 255.0f;
+        };
+
+        const glm::vec3 center( 0.0f,  0.0f, getHeight(x, y));
+        // go counter-clockwise around square starting and right apothem
+        const glm::vec3 points[8] = {
+            { 1.0f,  0.0f, getHeight(x,   yp1)},
+            { 1.0f,  1.0f, getHeight(xm1, yp1)},
+            { 0.0f,  1.0f, getHeight(xm1, y  )},
+            {-1.0f,  1.0f, getHeight(xm1, ym1)},
+            {-1.0f,  0.0f, getHeight(x,   ym1)},
+            {-1.0f, -1.0f, getHeight(xp1, ym1)},
+            { 0.0f, -1.0f, getHeight(xp1, y  )},
+            { 1.0f, -1.0f, getHeight(xp1, yp1)}
+        };
+
+        // When p1, p2, p3 are in counter-clockwise order (p1 is 0, 0, h_cc)
+        const auto getNorm = [&center](const glm::vec3& p2, const glm::vec3& p3)->glm::vec3 {
+            return glm::cross(p2 - center, p3 - center);
+        };
+
+        // Now go around the square as if it were a circle
+        for(uint8_t x = 0; x < 8; ++x)
+            sum += getNorm(points[x], points[(x + 1) % 8]);
+
+        sum = glm::normalize(sum);
+
+        out[0] = ((sum.x + 1.0f) / 2.0f) * 255.0f;
+        out[1] = ((sum.y + 1.0f) / 2.0f) * 255.0f;
+        out[2] = ((sum.z + 1.0f) / 2.0f) * 255.0f;
+        out[3] = 0xff;
+    }
+
+#ifdef NORMAL_KERNEL_SSE2
+    /// Four heights starting at p, scaled to [0, 1]
+    inline __m128 loadHeights(const uint8_t* p) {
+        int32_t bytes;
+        std::memcpy(&bytes, p, 4);
+        const __m128i zero = _mm_setzero_si128();
+        __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(bytes), zero);
+        v = _mm_unpacklo_epi16(v, zero);
+        return _mm_div_ps(_mm_cvtepi32_ps(v), _mm_set1_ps(255.0f));
+    }
+
+    /// ((v + 1) / 2) * 255, truncated like the float to uint8_t conversion
+    inline __m128i toByte(__m128 v) {
+        v = _mm_div_ps(_mm_add_ps(v, _mm_set1_ps(1.0f)), _mm_set1_ps(2.0f));
+        return _mm_cvttps_epi32(_mm_mul_ps(v, _mm_set1_ps(255.0f)));
+    }
+#endif
+}
+
+void NormalKernel::rowScalar(uint32_t w, uint32_t h, const uint8_t* height_map, uint32_t row, uint8_t* out) {
+    for(uint32_t y = 0; y < w; ++y)
+        texel(w, h, height_map, row, y, out + y * 4);
+}
+
+#ifdef NORMAL_KERNEL_SSE2
+
+void NormalKernel::rowSSE2(uint32_t w, uint32_t h, const uint8_t* height_map, uint32_t x, uint8_t* out) {
+    // The rows wrap here, so the loop itself never has to
+    const uint8_t* above = height_map + ((x != 0) ? (x - 1) : (h - 1)) * w;
+    const uint8_t* centre = height_map + x * w;
+    const uint8_t* below = height_map + ((x + 1) % h) * w;
+
+    // The columns wrap at the edges, so those go through the scalar code
+    texel(w, h, height_map, x, 0, out);
+    uint32_t y = 1;
+
+    // The cross products in texel() are against points at offsets of -1, 0
+    // and 1, so they are written out here with the multiplications dropped.
+    // Each is exact (a multiply by 1 or 0 and a subtraction from 0 only change
+    // the sign of a zero) and the sums keep their order, so every lane rounds
+    // the same way texel() does.
+    for(; y + 4 < w; y += 4) {
+        const __m128 c = loadHeights(centre + y);
+        const __m128 z0 = _mm_sub_ps(loadHeights(centre + y + 1), c);
+        const __m128 z1 = _mm_sub_ps(loadHeights(above  + y + 1), c);
+        const __m128 z2 = _mm_sub_ps(loadHeights(above  + y    ), c);
+        const __m128 z3 = _mm_sub_ps(loadHeights(above  + y - 1), c);
+        const __m128 z4 = _mm_sub_ps(loadHeights(centre + y - 1), c);
+        const __m128 z5 = _mm_sub_ps(loadHeights(below  + y - 1), c);
+        const __m128 z6 = _mm_sub_ps(loadHeights(below  + y    ), c);
+        const __m128 z7 = _mm_sub_ps(loadHeights(below  + y + 1), c);
+
+        __m128 sx = _mm_sub_ps(_mm_setzero_ps(), z0);
+        sx = _mm_add_ps(sx, _mm_sub_ps(z2, z1));
+        sx = _mm_add_ps(sx, _mm_sub_ps(z3, z2));
+        sx = _mm_add_ps(sx, z4);
+        sx = _mm_add_ps(sx, z4);
+        sx = _mm_add_ps(sx, _mm_sub_ps(z5, z6));
+        sx = _mm_add_ps(sx, _mm_sub_ps(z6, z7));
+        sx = _mm_sub_ps(sx, z0);
+
+        __m128 sy = _mm_sub_ps(z0, z1);
+        sy = _mm_sub_ps(sy, z2);
+        sy = _mm_sub_ps(sy, z2);
+        sy = _mm_add_ps(sy, _mm_sub_ps(z4, z3));
+        sy = _mm_add_ps(sy, _mm_sub_ps(z5, z4));
+        sy = _mm_add_ps(sy, z6);
+        sy = _mm_add_ps(sy, z6);
+        sy = _mm_add_ps(sy, _mm_sub_ps(z7, z0));
+
+        // Every triangle contributes exactly 1 to z
+        const __m128 sz = _mm_set1_ps(8.0f);
+
+        // glm::normalize multiplies by 1 / sqrt(dot(v, v))
+        const __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, sx), _mm_mul_ps(sy, sy)), _mm_mul_ps(sz, sz));
+        const __m128 inv = _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(dot));
+
+        const __m128i r = toByte(_mm_mul_ps(sx, inv));
+        const __m128i g = toByte(_mm_mul_ps(sy, inv));
+        const __m128i b = toByte(_mm_mul_ps(sz, inv));
+        __m128i rgba = _mm_or_si128(r, _mm_slli_epi32(g, 8));
+        rgba = _mm_or_si128(rgba, _mm_slli_epi32(b, 16));
+        rgba = _mm_or_si128(rgba, _mm_set1_epi32((int32_t)0xff000000));
+        _mm_storeu_si128((__m128i*)(out + y * 4), rgba);
+    }
+
+    for(; y < w; ++y)
+        texel(w, h, height_map, x, y, out + y * 4);
+}
+
+#else
+
+void NormalKernel::rowSSE2(uint32_t w, uint32_t h, const uint8_t* height_map, uint32_t row, uint8_t* out) {
+    rowScalar(w, h, height_map, row, out);
+}
+
+#endif
+
+NormalKernel::RowFunction NormalKernel::normalRow() {
+#ifdef NORMAL_KERNEL_SSE2
+    return rowSSE2;
+#else
+    return rowScalar;
+#endif
+}
@@ -1,20 +1,75 @@
 #include "objmesh.h"
 #include <iostream>
 
+#include "fastobj.h"
+#include "meshcache.h"
+#include "meshopt.h"
+
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.h"
 
-ObjMesh::ObjMesh(const std::string & fName, Shader& s ) : fileName(fName), shader(s) { }
+namespace {
+  void printBounds(const std::string& fileName, const glm::vec3& min, const glm::vec3& max)
+  {
+    printf("OBJ: %s\n", fileName.c_str());
+    printf("  BBox:   (%.4f, %.4f, %.4f) -> (%.4f, %.4f, %.4f)\n", min.x, min.y, min.z, max.x, max.y, max.z);
+    glm::vec3 c = 0.5f * (min + max);
+    printf("  Center: (%.4f, %.4f, %.4f)\n", c.x, c.y, c.z);
+  }
+}
+
+ObjMesh::ObjMesh(const std::string & fName, Shader& s ) :
+  fileName(fName), materialBuffer(0), prepared(false), fromCache(false), shader(s) { }
 
 ObjMesh::~ObjMesh() {}
 
 void ObjMesh::init()
 {
+  if (m_vao != 0) return;
+  prepare();
+
+  if (fromCache)
+    TriangleMesh::init(cache.indices, cache.index_count, cache.positions, cache.vertex_count, cache.normals);
+  else
+    TriangleMesh::init(built.indices.data(), built.indices.size(), built.positions.data(),
+                       built.positions.size() / 3, built.normals.data());
+  initMaterials(vertexMats);
+
+  // OpenGL has its own copy now
+  cache.file.close();
+  built = MeshCache::MeshData();
+  std::vector<GLfloat>().swap(vertexMats);
+}
+
+void ObjMesh::prepare()
+{
+  if (prepared) return;
+  prepared = true;
+
+  // The buffers from a previous run can be uploaded straight from the mapped cache
+  if (MeshCache::load(fileName, cache)) {
+    fromCache = true;
+    materials = cache.materials;
+    parts.clear();
+    for (GLuint i = 0; i < cache.part_count; i++) {
+      ObjShape s;
+      s.nVerts = cache.parts[i].count;
+      s.start = cache.parts[i].start;
+      s.matIndex = cache.parts[i].material;
+      parts.push_back(s);
+    }
+
+    printBounds(fileName, cache.min, cache.max);
+    setBounds(cache.positions, cache.vertex_count);
+    vertexMats = vertexMaterials(cache.indices, cache.vertex_count);
+    return;
+  }
+
   std::vector<tinyobj::shape_t> shapes;
   std::vector<tinyobj::material_t> mats;
 
   std::string err;
-  bool ret = tinyobj::LoadObj(shapes, mats, err, fileName.c_str());
+  bool ret = FastObj::LoadObj(shapes, mats, err, fileName.c_str());
 
   if (!err.empty()) { // `err` may contain warning message.
     std::cerr << err << std::endl;
@@ -33,9 +88,14 @@ void ObjMesh::init()
     materials.push_back(m);
   }
 
+  // Faces without a valid material get a default one at the end
+  const GLuint noMaterial = materials.size();
+  bool usesNoMaterial = false;
+
   std::vector<GLfloat> pts;
   std::vector<GLfloat> norm;
   std::vector<GLuint> el;
+  std::vector<GLuint> faceMats;
 
   glm::vec3
     min(std::numeric_limits<float>::max()),
@@ -62,38 +122,75 @@ void ObjMesh::init()
       pts.push_back(z);
     }
 
-    ObjShape s;
-    if(shapes.size() > 0)
-    {
-      s.nVerts = 0;
-      s.start = el.size();
-      s.matIndex = m.material_ids[0];
-    }
     for (size_t f = 0; f < m.indices.size() / 3; f++) {
       GLuint matId = m.material_ids[f];
-      if( s.matIndex != matId )
-      {
-        if(s.nVerts > 0) parts.push_back(s);
-        s.nVerts = 0;
-        s.start = el.size();
-        s.matIndex = matId;
+      if( matId >= noMaterial ) {
+        matId = noMaterial;
+        usesNoMaterial = true;
       }
       el.push_back(m.indices[3*f+0] + startIndex);
       el.push_back(m.indices[3*f+1] + startIndex);
       el.push_back(m.indices[3*f+2] + startIndex);
-      s.nVerts += 3;
+      faceMats.push_back(matId);
     }
-    if( s.nVerts > 0 ) parts.push_back(s);
   }
+  if (usesNoMaterial) materials.push_back(Material());
 
-  printf("OBJ: %s\n", fileName.c_str());
-  printf("  BBox:   (%.4f, %.4f, %.4f) -> (%.4f, %.4f, %.4f)\n", min.x, min.y, min.z, max.x, max.y, max.z);
-  glm::vec3 c = 0.5f * (min + max);
-  printf("  Center: (%.4f, %.4f, %.4f)\n", c.x, c.y, c.z);
+  // Regroup the triangles by material across every shape, so each material is one range
+  std::vector<GLuint> offsets(materials.size() + 1, 0);
+  for (GLuint m : faceMats) offsets[m + 1] += 3;
+  for (size_t i = 0; i < materials.size(); i++) {
+    if (offsets[i + 1] > 0) {
+      ObjShape s = { offsets[i + 1], offsets[i], (GLuint)i };
+      parts.push_back(s);
+    }
+    offsets[i + 1] += offsets[i];
+  }
+  std::vector<GLuint> grouped(el.size());
+  for (size_t f = 0; f < faceMats.size(); f++) {
+    GLuint& at = offsets[faceMats[f]];
+    grouped[at++] = el[3*f+0];
+    grouped[at++] = el[3*f+1];
+    grouped[at++] = el[3*f+2];
+  }
+  el.swap(grouped);
+
+  printBounds(fileName, min, max);
+  setBounds(pts.data(), pts.size() / 3);
 
   generateNormals(pts, norm, el);
 
-  TriangleMesh::init(&el, &pts, &norm);
+  // Each part is reordered on its own so it stays one range, and the material
+  // stream keeps vertices of different materials from being welded together
+  vertexMats = vertexMaterials(el.data(), pts.size() / 3);
+  std::vector<MeshOpt::Stream> streams;
+  MeshOpt::Stream ps = { &pts, 3 }, ns = { &norm, 3 }, ms = { &vertexMats, 1 };
+  streams.push_back(ps);
+  streams.push_back(ns);
+  streams.push_back(ms);
+  std::vector<MeshOpt::Range> ranges;
+  for (auto&& i : parts) {
+    MeshOpt::Range r = { i.start, i.nVerts };
+    ranges.push_back(r);
+  }
+  MeshOpt::Report report = MeshOpt::optimize(el, streams, ranges);
+  printf("  Verts:  %u -> %u\n", report.vertices_before, report.vertices_after);
+  printf("  ACMR:   %.3f -> %.3f\n", report.acmr_before, report.acmr_after);
+
+  // Kept until init() uploads it
+  MeshCache::MeshData& data = built;
+  data.positions.swap(pts);
+  data.normals.swap(norm);
+  data.indices.swap(el);
+  for (auto&& i : parts) {
+    MeshCache::Part p = { i.nVerts, i.start, i.matIndex };
+    data.parts.push_back(p);
+  }
+  data.materials = materials;
+  data.min = min;
+  data.max = max;
+  if (!MeshCache::save(fileName, data))
+    qWarning("Unable to write mesh cache for %s", fileName.c_str());
 }
 
 void ObjMesh::generateNormals( std::vector<GLfloat> &pts, std::vector<GLfloat> &norm, std::vector<GLuint> &faces)
@@ -135,6 +232,58 @@ void ObjMesh::generateNormals( std::vector<GLfloat> &pts, std::vector<GLfloat> &
   }
 }
 
+std::vector<GLfloat> ObjMesh::vertexMaterials(const GLuint* el, GLuint vertices) const
+{
+  std::vector<GLfloat> mats(vertices, 0.0f);
+  for (auto&& p : parts)
+    for (GLuint i = p.start; i < p.start + p.nVerts; i++)
+      mats[el[i]] = (GLfloat)p.matIndex;
+  return mats;
+}
+
+void ObjMesh::initMaterials(const std::vector<GLfloat>& perVertex)
+{
+  drawCounts.clear();
+  drawOffsets.clear();
+  for (auto&& p : parts) {
+    drawCounts.push_back(p.nVerts);
+    drawOffsets.push_back((const GLvoid *)(sizeof(GLuint) * p.start));
+  }
+
+  // render() falls back to setting the uniforms for each part
+  materialBuffer = 0;
+  if (materials.size() > MAX_MATERIALS) return;
+
+  QOpenGLFunctions_4_1_Core* gl =
+    QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_4_1_Core>();
+
+  GLuint buffers[2];
+  gl->glGenBuffers(2, buffers);
+  m_buffers.push_back(buffers[0]);
+  m_buffers.push_back(buffers[1]);
+
+  // The material index is bound to vertex attribute 5
+  gl->glBindVertexArray(m_vao);
+  gl->glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+  gl->glBufferData(GL_ARRAY_BUFFER, perVertex.size() * sizeof(GLfloat), perVertex.data(), GL_STATIC_DRAW);
+  gl->glVertexAttribPointer(5, 1, GL_FLOAT, GL_FALSE, 0, 0);
+  gl->glEnableVertexAttribArray(5);
+  gl->glBindVertexArray(0);
+
+  // std140 layout of MaterialData, the whole block must be backed by the buffer
+  std::vector<glm::vec4> block(MAX_MATERIALS * 4, glm::vec4(0.0f));
+  for (size_t i = 0; i < materials.size(); i++) {
+    block[4*i+0] = glm::vec4(materials[i].Le, 0.0f);
+    block[4*i+1] = glm::vec4(materials[i].Ka, 0.0f);
+    block[4*i+2] = glm::vec4(materials[i].Kd, 0.0f);
+    block[4*i+3] = glm::vec4(materials[i].Ks, materials[i].shine);
+  }
+  gl->glBindBuffer(GL_UNIFORM_BUFFER, buffers[1]);
+  gl->glBufferData(GL_UNIFORM_BUFFER, block.size() * sizeof(glm::vec4), block.data(), GL_STATIC_DRAW);
+  gl->glBindBuffer(GL_UNIFORM_BUFFER, 0);
+  materialBuffer = buffers[1];
+}
+
 void ObjMesh::render() {
     if( m_vao == 0 ) throw std::runtime_error("Cannot render uninitlized ObjMesh.");
 
@@ -144,11 +293,23 @@ void ObjMesh::render() {
     // Bind the VAO.  This re-enables the settings stored in the VAO including
     // the connections between vertex attributes (shader inputs) and vertex buffers.
     gl->glBindVertexArray(m_vao);
-    for( GLuint i = 0; i < parts.size(); i++ )
+    if( materialBuffer != 0 )
+    {
+      // Each vertex picks its material from the block, so every part goes in one call.
+      // World::init() pointed the block at MATERIAL_BINDING.
+      gl->glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_BINDING, materialBuffer);
+      shader.setUniform("use_material_block", true);
+      gl->glMultiDrawElements(GL_TRIANGLES, drawCounts.data(), GL_UNSIGNED_INT, drawOffsets.data(), drawCounts.size());
+      shader.setUniform("use_material_block", false);
+    }
+    else
     {
-      materials[ parts[i].matIndex ].setUniforms(shader);
-      // Draw the triangles using the buffers defined in the VAO
-      gl->glDrawElements(GL_TRIANGLES, parts[i].nVerts, GL_UNSIGNED_INT, (GLvoid *)(sizeof(GLuint) * parts[i].start));
+      for( GLuint i = 0; i < parts.size(); i++ )
+      {
+        materials[ parts[i].matIndex ].setUniforms(shader);
+        // Draw the triangles using the buffers defined in the VAO
+        gl->glDrawElements(GL_TRIANGLES, parts[i].nVerts, GL_UNSIGNED_INT, (GLvoid *)(sizeof(GLuint) * parts[i].start));
+      }
     }
     // Un-bind the VAO
     gl->glBindVertexArray(0);
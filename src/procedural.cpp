@@ -2,50 +2,134 @@
 #include <cstdio>
 #include <glm/gtc/noise.hpp>
 #include <algorithm>
+#include <vector>
 
-uint8_t* Procedural::generateHeightMap(uint32_t w, uint32_t h) {
-    if(w == 0 || h == 0) return nullptr;
+#include "heightkernel.h"
+#include "normalkernel.h"
+#include "threadpool.h"
+
+namespace {
+    /// Maps with more texels than this are generated in two passes instead of keeping a float copy
+    const size_t IN_MEMORY_LIMIT = 4096 * 4096;
 
-    float min = 1e10;
-    float max = -1e10;
+    /// Splits a map into tiles of at most size by size texels
+    struct TileGrid {
+        uint32_t w, h, size, columns, rows;
 
-    float fdata[w * h];
-    for(uint32_t x = 0; x < h; ++x) {
-        uint32_t offset = x * w;
+        TileGrid(uint32_t w, uint32_t h, uint32_t size) :
+            w(w), h(h), size(size), columns((w + size - 1) / size), rows((h + size - 1) / size) {}
 
-        for(uint32_t y = 0; y < w; ++y) {
-            float& i = fdata[offset + y];
-            //i  = glm::simplex(glm::vec2(x, y)) / 2.0f;
-            i = 0;
-            i += glm::simplex(glm::vec2(x / 8.0f, y / 8.0f)) / 4.0f;
-            i += glm::simplex(glm::vec2(x / 4.0f, y / 4.0f)) / 2.0f;
-            i += glm::simplex(glm::vec2(x / 2.0f, y / 2.0f));
-            i += glm::simplex(glm::vec3(x * 2.0f, y * 2.0f, x * y / 10.0f)) * 4.0f;
+        inline size_t count() const { return (size_t)columns * rows; }
 
-            min = std::min(min, i);
-            max = std::max(max, i);
+        Procedural::HeightTile at(size_t i) const {
+            Procedural::HeightTile t;
+            t.row = (i / columns) * size;
+            t.column = (i % columns) * size;
+            t.rows = std::min(size, h - t.row);
+            t.columns = std::min(size, w - t.column);
+            t.data = nullptr;
+            return t;
+        }
+    };
+
+    /// Evaluates the noise for a tile into out[row][column] and widens min and max to its range
+    void evaluateTile(const Procedural::HeightTile& t, float* out, float& min, float& max) {
+        const HeightKernel::RowFunction row = HeightKernel::heightRow();
+        for(uint32_t x = 0; x < t.rows; ++x) {
+            float* line = out + (size_t)x * t.columns;
+            row(t.row + x, t.column, t.columns, line);
+            for(uint32_t y = 0; y < t.columns; ++y) {
+                min = std::min(min, line[y]);
+                max = std::max(max, line[y]);
+            }
         }
     }
 
-    float range = max - min;
+    inline uint8_t quantize(float val, float min, float range) {
+        val += std::abs(min);
+        val /= range;
+        return (uint8_t)(255.0f * val);
+    }
+}
 
-    uint8_t* udata =  new uint8_t[w * h];
-    for(uint32_t x = 0; x < h; ++x) {
-        uint32_t offset = x * w;
+uint8_t* Procedural::generateHeightMap(uint32_t w, uint32_t h) {
+    if(w == 0 || h == 0) return nullptr;
 
-        for(uint32_t y = 0; y < w; ++y) {
-            uint8_t& i = udata[offset + y];
-            float val = fdata[offset + y];
-            val += std::abs(min);
-            val /= range;
+    uint8_t* udata = new uint8_t[(size_t)w * h];
 
-            i = (uint8_t)(255.0f * val);
-        }
+    // Huge maps are not worth four bytes a texel of scratch, stream them instead
+    if((size_t)w * h > IN_MEMORY_LIMIT) {
+        generateHeightMapTiles(w, h, [udata, w](const HeightTile& t) {
+            for(uint32_t x = 0; x < t.rows; ++x)
+                std::copy(t.data + (size_t)x * t.columns, t.data + (size_t)(x + 1) * t.columns,
+                          udata + (size_t)(t.row + x) * w + t.column);
+        });
+        return udata;
     }
 
+    const TileGrid grid(w, h, 128);
+    std::vector<float> fdata(grid.count() * grid.size * grid.size);
+    std::vector<float> mins(grid.count(), 1e10f);
+    std::vector<float> maxs(grid.count(), -1e10f);
+
+    // Tiles are stored contiguously, one after another
+    ThreadPool::global().parallelFor(0, grid.count(), [&](size_t i) {
+        evaluateTile(grid.at(i), &fdata[i * grid.size * grid.size], mins[i], maxs[i]);
+    });
+
+    const float min = *std::min_element(mins.begin(), mins.end());
+    const float max = *std::max_element(maxs.begin(), maxs.end());
+    const float range = max - min;
+
+    ThreadPool::global().parallelFor(0, grid.count(), [&](size_t i) {
+        const HeightTile t = grid.at(i);
+        const float* tile = &fdata[i * grid.size * grid.size];
+        for(uint32_t x = 0; x < t.rows; ++x) {
+            uint8_t* out = udata + (size_t)(t.row + x) * w + t.column;
+            for(uint32_t y = 0; y < t.columns; ++y)
+                out[y] = quantize(tile[x * t.columns + y], min, range);
+        }
+    });
+
     return udata;
 }
 
+void Procedural::generateHeightMapTiles(uint32_t w, uint32_t h, const std::function<void(const HeightTile&)>& sink, uint32_t tile) {
+    if(w == 0 || h == 0 || tile == 0) return;
+
+    const TileGrid grid(w, h, tile);
+    std::vector<float> mins(grid.count(), 1e10f);
+    std::vector<float> maxs(grid.count(), -1e10f);
+
+    // Each worker keeps one tile of scratch for both passes
+    static thread_local std::vector<float> fdata;
+    static thread_local std::vector<uint8_t> udata;
+
+    // First pass only finds the range, nothing is kept
+    ThreadPool::global().parallelFor(0, grid.count(), [&](size_t i) {
+        fdata.resize((size_t)tile * tile);
+        evaluateTile(grid.at(i), &fdata[0], mins[i], maxs[i]);
+    });
+
+    const float min = *std::min_element(mins.begin(), mins.end());
+    const float max = *std::max_element(maxs.begin(), maxs.end());
+    const float range = max - min;
+
+    ThreadPool::global().parallelFor(0, grid.count(), [&](size_t i) {
+        HeightTile t = grid.at(i);
+        float unused_min = 0.0f, unused_max = 0.0f;
+        fdata.resize((size_t)tile * tile);
+        udata.resize((size_t)tile * tile);
+        evaluateTile(t, &fdata[0], unused_min, unused_max);
+
+        for(size_t x = 0; x < (size_t)t.rows * t.columns; ++x)
+            udata[x] = quantize(fdata[x], min, range);
+
+        t.data = &udata[0];
+        sink(t);
+    });
+}
+
 uint8_t* Procedural::generateAlternatingGrid(uint32_t x, uint32_t y) {
     if(x == 0 || y == 0) return nullptr;
     uint32_t size = x * y;
@@ -91,51 +175,104 @@ uint8_t* Procedural::generateNormalMap(uint32_t w, uint32_t h, const uint8_t* he
 
     // See response from Adrian McCarthy to:
     // http://stackoverflow.com/questions/5281261/generating-a-normal-map-from-a-height-map
-    for(uint32_t x = 0; x < h; ++x) {
-        for(uint32_t y = 0; y < w; ++y) {
-            glm::vec3 sum(0.0f, 0.0f, 0.0f); //The sum of all the triangle normals
-
-            // Wrap end values xp1 = x plus 1, xm1 = x minus 1
-            // This makes the seams much harder to spot
-            const uint32_t xp1 = (x + 1) % h;
-            const uint32_t yp1 = (y + 1) % w;
-            const uint32_t xm1 = ( (x != 0) ? (x - 1) : (h - 1) );
-            const uint32_t ym1 = ( (y != 0) ? (y - 1) : (w - 1) );
-
-            const auto getHeight = [&](uint32_t a, uint32_t b)->float {
-                return ((float)height_map[a * w + b]) / 255.0f;
-            };
-
-            const glm::vec3 center( 0.0f,  0.0f, getHeight(x, y));
-            // go counter-clockwise around square starting and right apothem
-            const glm::vec3 points[8] = {
-                { 1.0f,  0.0f, getHeight(x,   yp1)},
-                { 1.0f,  1.0f, getHeight(xm1, yp1)},
-                { 0.0f,  1.0f, getHeight(xm1, y  )},
-                {-1.0f,  1.0f, getHeight(xm1, ym1)},
-                {-1.0f,  0.0f, getHeight(x,   ym1)},
-                {-1.0f, -1.0f, getHeight(xp1, ym1)},
-                { 0.0f, -1.0f, getHeight(xp1, y  )},
-                { 1.0f, -1.0f, getHeight(xp1, yp1)}
-            };
-
-            // When p1, p2, p3 are in counter-clockwise order (p1 is 0, 0, h_cc)
-            const auto getNorm = [&center](const glm::vec3& p2, const glm::vec3& p3)->glm::vec3 {
-                return glm::cross(p2 - center, p3 - center);
-            };
-
-            // Now go around the square as if it were a circle
-            for(uint8_t x = 0; x < 8; ++x)
-                sum += getNorm(points[x], points[(x + 1) % 8]);
+    // Rows only read the height map, so bands of them can be done in parallel
+    const NormalKernel::RowFunction row = NormalKernel::normalRow();
+    const uint32_t band = 32;
+    ThreadPool::global().parallelFor(0, (h + band - 1) / band, [&](size_t i) {
+        const uint32_t end = std::min<uint32_t>((i + 1) * band, h);
+        for(uint32_t x = i * band; x < end; ++x)
+            row(w, h, height_map, x, normal_map + (size_t)x * w * 4);
+    });
+
+    return normal_map;
+}
+
+uint8_t* Procedural::downsampleNormalMap(uint32_t w, uint32_t h, const uint8_t* normal_map) {
+    if(normal_map == nullptr || w == 0 || h == 0) return nullptr;
+
+    const uint32_t nw = std::max(1u, w / 2);
+    const uint32_t nh = std::max(1u, h / 2);
+    uint8_t* result = new uint8_t[nw * nh * 4];
 
+    const auto getNormal = [&](uint32_t a, uint32_t b)->glm::vec3 {
+        const uint8_t* t = &normal_map[(std::min(a, h - 1) * w + std::min(b, w - 1)) * 4];
+        return glm::vec3(t[0], t[1], t[2]) / 127.5f - 1.0f;
+    };
+
+    for(uint32_t x = 0; x < nh; ++x) {
+        for(uint32_t y = 0; y < nw; ++y) {
+            glm::vec3 sum =
+                getNormal(x * 2,     y * 2) + getNormal(x * 2,     y * 2 + 1) +
+                getNormal(x * 2 + 1, y * 2) + getNormal(x * 2 + 1, y * 2 + 1);
             sum = glm::normalize(sum);
 
-            normal_map[x * w * 4 + y * 4 + 0] = ((sum.x + 1.0f) / 2.0f) * 255.0f;
-            normal_map[x * w * 4 + y * 4 + 1] = ((sum.y + 1.0f) / 2.0f) * 255.0f;
-            normal_map[x * w * 4 + y * 4 + 2] = ((sum.z + 1.0f) / 2.0f) * 255.0f;
-            normal_map[x * w * 4 + y * 4 + 3] = 0xff;
+            result[x * nw * 4 + y * 4 + 0] = ((sum.x + 1.0f) / 2.0f) * 255.0f;
+            result[x * nw * 4 + y * 4 + 1] = ((sum.y + 1.0f) / 2.0f) * 255.0f;
+            result[x * nw * 4 + y * 4 + 2] = ((sum.z + 1.0f) / 2.0f) * 255.0f;
+            result[x * nw * 4 + y * 4 + 3] = 0xff;
         }
     }
 
-    return normal_map;
+    return result;
+}
+
+namespace {
+    /**
+     * Encodes one channel of a 4x4 block as BC4. Uses the eight value mode with
+     * the endpoints at the extremes of the block.
+     *
+     * @param texels The 16 values in row-major order
+     * @param out    Where to write the 8 byte block
+     */
+    void encodeBC4(const uint8_t texels[16], uint8_t* out) {
+        const uint8_t max = *std::max_element(texels, texels + 16);
+        const uint8_t min = *std::min_element(texels, texels + 16);
+        out[0] = max;
+        out[1] = min;
+
+        uint64_t bits = 0;
+        if(max != min) {
+            for(uint32_t x = 0; x < 16; ++x) {
+                // Position along the ramp, 0 = min and 7 = max
+                uint32_t p = ((texels[x] - min) * 14 + (max - min)) / ((max - min) * 2);
+                // The palette is ordered max, min, then interpolants from max to min
+                uint64_t index = (p == 7) ? 0 : (p == 0) ? 1 : 8 - p;
+                bits |= index << (3 * x);
+            }
+        }
+
+        for(uint32_t x = 0; x < 6; ++x)
+            out[2 + x] = (bits >> (8 * x)) & 0xff;
+    }
+}
+
+uint8_t* Procedural::compressNormalMapRGTC(uint32_t w, uint32_t h, const uint8_t* normal_map) {
+    if(normal_map == nullptr || w == 0 || h == 0) return nullptr;
+
+    const uint32_t bw = (w + 3) / 4;
+    const uint32_t bh = (h + 3) / 4;
+    uint8_t* blocks = new uint8_t[bw * bh * 16];
+
+    for(uint32_t bx = 0; bx < bh; ++bx) {
+        for(uint32_t by = 0; by < bw; ++by) {
+            uint8_t red[16];
+            uint8_t green[16];
+
+            // Blocks hanging off the edge of small mip levels repeat the last texel
+            for(uint32_t x = 0; x < 4; ++x) {
+                for(uint32_t y = 0; y < 4; ++y) {
+                    const uint32_t row = std::min(bx * 4 + x, h - 1);
+                    const uint32_t col = std::min(by * 4 + y, w - 1);
+                    red[x * 4 + y]   = normal_map[(row * w + col) * 4 + 0];
+                    green[x * 4 + y] = normal_map[(row * w + col) * 4 + 1];
+                }
+            }
+
+            uint8_t* block = &blocks[(bx * bw + by) * 16];
+            encodeBC4(red, block);
+            encodeBC4(green, block + 8);
+        }
+    }
+
+    return blocks;
 }
@@ -0,0 +1,230 @@
+#include "proceduralgpu.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+#include "procedural.h"
+
+namespace {
+    /// Restores everything the passes change when it goes out of scope
+    struct SavedState {
+        QOpenGLFunctions_4_1_Core* gl;
+        GLint program, draw_fbo, read_fbo, vao, active_texture;
+        GLint textures[2];
+        GLint viewport[4];
+
+        explicit SavedState(QOpenGLFunctions_4_1_Core* gl) : gl(gl) {
+            gl->glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+            gl->glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &draw_fbo);
+            gl->glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_fbo);
+            gl->glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &vao);
+            gl->glGetIntegerv(GL_ACTIVE_TEXTURE, &active_texture);
+            gl->glGetIntegerv(GL_VIEWPORT, viewport);
+            for(GLint x = 0; x < 2; ++x) {
+                gl->glActiveTexture(GL_TEXTURE0 + x);
+                gl->glGetIntegerv(GL_TEXTURE_BINDING_2D, &textures[x]);
+            }
+        }
+
+        ~SavedState() {
+            for(GLint x = 0; x < 2; ++x) {
+                gl->glActiveTexture(GL_TEXTURE0 + x);
+                gl->glBindTexture(GL_TEXTURE_2D, textures[x]);
+            }
+            gl->glActiveTexture(active_texture);
+            gl->glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+            gl->glBindVertexArray(vao);
+            gl->glBindFramebuffer(GL_DRAW_FRAMEBUFFER, draw_fbo);
+            gl->glBindFramebuffer(GL_READ_FRAMEBUFFER, read_fbo);
+            gl->glUseProgram(program);
+        }
+    };
+
+    /// Deletes a texture when it goes out of scope, unless release()d first
+    struct TextureGuard {
+        QOpenGLFunctions_4_1_Core* gl;
+        GLuint id;
+
+        TextureGuard(QOpenGLFunctions_4_1_Core* gl, GLuint id) : gl(gl), id(id) {}
+        ~TextureGuard() { reset(0); }
+
+        TextureGuard(const TextureGuard&) = delete;
+        TextureGuard& operator=(const TextureGuard&) = delete;
+
+        void reset(GLuint next) {
+            if(id != 0) gl->glDeleteTextures(1, &id);
+            id = next;
+        }
+        GLuint release() {
+            GLuint owned = id;
+            id = 0;
+            return owned;
+        }
+    };
+
+    void build(Shader& shader, const char* fragment) {
+        shader.compileStageFile("shaders/procedural.vert");
+        shader.compileStageFile(fragment);
+        shader.link();
+    }
+
+    /// @return The largest difference between any two bytes of a and b
+    int maxDifference(const uint8_t* a, const uint8_t* b, size_t size) {
+        int diff = 0;
+        for(size_t x = 0; x < size; ++x)
+            diff = std::max(diff, std::abs((int)a[x] - (int)b[x]));
+        return diff;
+    }
+}
+
+ProceduralGPU::ProceduralGPU() : vao(0), fbo(0) {
+    gl = QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_4_1_Core>();
+
+    build(height_shader, "shaders/procedural_height.frag");
+    build(range_shader, "shaders/procedural_range.frag");
+    build(quantize_shader, "shaders/procedural_quantize.frag");
+    build(normal_shader, "shaders/procedural_normal.frag");
+
+    gl->glGenVertexArrays(1, &vao);
+    gl->glGenFramebuffers(1, &fbo);
+}
+
+ProceduralGPU::~ProceduralGPU() {
+    gl->glDeleteFramebuffers(1, &fbo);
+    gl->glDeleteVertexArrays(1, &vao);
+}
+
+GLuint ProceduralGPU::makeTexture(uint32_t w, uint32_t h, GLenum internal_format, GLenum format, GLenum type) {
+    GLuint id = 0;
+    gl->glGenTextures(1, &id);
+    gl->glBindTexture(GL_TEXTURE_2D, id);
+    gl->glTexImage2D(GL_TEXTURE_2D, 0, internal_format, w, h, 0, format, type, nullptr);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    return id;
+}
+
+void ProceduralGPU::draw(Shader& shader, GLuint target, uint32_t w, uint32_t h) {
+    shader.use();
+    gl->glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target, 0);
+    if(gl->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        // Attached, target would live on with the framebuffer after the caller deletes it
+        gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+        throw std::runtime_error("ProceduralGPU could not render to a texture.");
+    }
+
+    gl->glViewport(0, 0, w, h);
+    gl->glBindVertexArray(vao);
+    gl->glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, 0, 0);
+}
+
+GLuint ProceduralGPU::range(GLuint heights, uint32_t w, uint32_t h) {
+    // Each pass reduces 4x4 blocks until only one texel is left
+    GLuint source = heights;
+    // The last pass's output, heights belongs to the caller
+    TextureGuard reduced(gl, 0);
+    bool first = true;
+    do {
+        w = (w + 3) / 4;
+        h = (h + 3) / 4;
+        TextureGuard dest(gl, makeTexture(w, h, GL_RG32F, GL_RG, GL_FLOAT));
+
+        gl->glActiveTexture(GL_TEXTURE0);
+        gl->glBindTexture(GL_TEXTURE_2D, source);
+        range_shader.use();
+        range_shader.setUniform("source", 0);
+        range_shader.setUniform("first", first ? 1 : 0);
+        draw(range_shader, dest.id, w, h);
+
+        reduced.reset(dest.release());
+        source = reduced.id;
+        first = false;
+    } while(w > 1 || h > 1);
+
+    return reduced.release();
+}
+
+GLuint ProceduralGPU::generateHeightMap(uint32_t w, uint32_t h) {
+    if(w == 0 || h == 0) return 0;
+    SavedState saved(gl);
+
+    TextureGuard noise(gl, makeTexture(w, h, GL_R32F, GL_RED, GL_FLOAT));
+    draw(height_shader, noise.id, w, h);
+    TextureGuard minmax(gl, range(noise.id, w, h));
+
+    TextureGuard heights(gl, makeTexture(w, h, GL_R8, GL_RED, GL_UNSIGNED_BYTE));
+    gl->glActiveTexture(GL_TEXTURE0);
+    gl->glBindTexture(GL_TEXTURE_2D, noise.id);
+    gl->glActiveTexture(GL_TEXTURE1);
+    gl->glBindTexture(GL_TEXTURE_2D, minmax.id);
+    quantize_shader.use();
+    quantize_shader.setUniform("noise", 0);
+    quantize_shader.setUniform("range", 1);
+    draw(quantize_shader, heights.id, w, h);
+    return heights.release();
+}
+
+GLuint ProceduralGPU::generateNormalMap(uint32_t w, uint32_t h, GLuint height_map) {
+    if(height_map == 0 || w == 0 || h == 0) return 0;
+    SavedState saved(gl);
+
+    // Only x and y, the shader reconstructs z, as it does for the CPU path's RGTC2
+    TextureGuard normals(gl, makeTexture(w, h, GL_RG8, GL_RG, GL_UNSIGNED_BYTE));
+    gl->glActiveTexture(GL_TEXTURE0);
+    gl->glBindTexture(GL_TEXTURE_2D, height_map);
+    normal_shader.use();
+    normal_shader.setUniform("heights", 0);
+    draw(normal_shader, normals.id, w, h);
+
+    // The mip chain is built in place, like TextureCache::upload sets it up
+    gl->glBindTexture(GL_TEXTURE_2D, normals.id);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 1000);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    gl->glGenerateMipmap(GL_TEXTURE_2D);
+    return normals.release();
+}
+
+bool ProceduralGPU::verify(uint32_t w, uint32_t h, int tolerance) {
+    if(w == 0 || h == 0) return true;
+
+    std::vector<uint8_t> gpu_heights((size_t)w * h);
+    std::vector<uint8_t> gpu_normals((size_t)w * h * 2);
+    {
+        TextureGuard heights(gl, generateHeightMap(w, h));
+        TextureGuard normals(gl, generateNormalMap(w, h, heights.id));
+
+        SavedState saved(gl);
+        gl->glActiveTexture(GL_TEXTURE0);
+        gl->glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        gl->glBindTexture(GL_TEXTURE_2D, heights.id);
+        gl->glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_UNSIGNED_BYTE, &gpu_heights[0]);
+        gl->glBindTexture(GL_TEXTURE_2D, normals.id);
+        gl->glGetTexImage(GL_TEXTURE_2D, 0, GL_RG, GL_UNSIGNED_BYTE, &gpu_normals[0]);
+        gl->glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    }
+
+    std::unique_ptr<uint8_t[]> cpu_heights(Procedural::generateHeightMap(w, h));
+    std::unique_ptr<uint8_t[]> cpu_normals(Procedural::generateNormalMap(w, h, cpu_heights.get()));
+    // The GPU map only keeps x and y
+    std::vector<uint8_t> cpu_xy(gpu_normals.size());
+    for(size_t x = 0; x < (size_t)w * h; ++x) {
+        cpu_xy[x * 2] = cpu_normals[x * 4];
+        cpu_xy[x * 2 + 1] = cpu_normals[x * 4 + 1];
+    }
+
+    const int height_diff = maxDifference(cpu_heights.get(), &gpu_heights[0], gpu_heights.size());
+    const int normal_diff = maxDifference(&cpu_xy[0], &gpu_normals[0], gpu_normals.size());
+    printf("ProceduralGPU: %ux%u height map is within %d of the CPU, normal map within %d\n",
+           w, h, height_diff, normal_diff);
+
+    return height_diff <= tolerance && normal_diff <= tolerance;
+}
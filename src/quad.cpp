@@ -1,11 +1,10 @@
 #include "shapes.h"
 
-void Quad::init() {
-    if (m_vao != 0) return;
-
-    std::vector<GLfloat> pts;
-    std::vector<GLfloat> norm;
-    std::vector<GLuint> el = { 0, 1, 2, 0, 2, 3 };
+MeshData Quad::build() const {
+    MeshData data;
+    std::vector<GLfloat>& pts = data.positions;
+    std::vector<GLfloat>& norm = data.normals;
+    data.indices = { 0, 1, 2, 0, 2, 3 };
 
     glm::vec3 n = glm::normalize(glm::cross(p[1] - p[0], p[2] - p[0]));
 
@@ -14,5 +13,5 @@ void Quad::init() {
         PUSH_BACK_VEC3(norm, n);
     }
 
-    TriangleMesh::init(&el, &pts, &norm);
+    return data;
 }
@@ -0,0 +1,111 @@
+#include "racesession.h"
+
+constexpr double RaceSession::BACKGROUND_FPS;
+
+RaceSession::RaceSession(unsigned tick_hz) :
+        tick_hz(tick_hz), focused_fps(0.0), background_fps(BACKGROUND_FPS), focused(true),
+        mouse_x(0.0f), mouse_y(0.0f), world("race.json", shader) {}
+
+RaceSession::~RaceSession() {
+    // Both threads use the world until they have stopped
+    simulation.reset();
+    renderer.reset();
+}
+
+void RaceSession::start(RenderThread* r, int width, int height) {
+    renderer.reset(r);
+    renderer->setFrameCap(focused ? focused_fps : background_fps);
+    // Compiles the shader and uploads the world in its own context
+    renderer->start();
+
+    simulation.reset(new Simulation(world, *renderer, tick_hz));
+    simulation->send(Simulation::Input::RESIZE, 0, width, height);
+    simulation->start();
+
+    watchScene();
+}
+
+void RaceSession::watchScene() {
+    reload_timer.setSingleShot(true);
+    reload_timer.setInterval(100);
+    QObject::connect(&reload_timer, &QTimer::timeout, [this]() { renderer->requestReload(); });
+
+    const QString path = QString::fromStdString(world.scene_file);
+    scene_watcher.addPath(path);
+    QObject::connect(&scene_watcher, &QFileSystemWatcher::fileChanged, [this, path]() {
+        // Saving by replacing the file drops it from the watcher
+        if(!scene_watcher.files().contains(path)) scene_watcher.addPath(path);
+        reload_timer.start();
+    });
+}
+
+void RaceSession::setFrameCaps(double focused_cap, double background_cap) {
+    focused_fps = focused_cap;
+    background_fps = background_cap;
+    if(renderer) renderer->setFrameCap(focused ? focused_fps : background_fps);
+}
+
+void RaceSession::setFocused(bool now_focused) {
+    focused = now_focused;
+    // Still drawn without focus, e.g. on a second screen, just not as often
+    if(renderer) renderer->setFrameCap(focused ? focused_fps : background_fps);
+}
+
+int RaceSession::getKey(Qt::Key key) {
+    switch (key) {
+        case Qt::Key_W: return Simulation::KEYS_W;
+        case Qt::Key_A: return Simulation::KEYS_A;
+        case Qt::Key_S: return Simulation::KEYS_S;
+        case Qt::Key_D: return Simulation::KEYS_D;
+        case Qt::Key_Q: return Simulation::KEYS_Q;
+        case Qt::Key_E: return Simulation::KEYS_E;
+        case Qt::Key_Space: return Simulation::KEYS_SPACE;
+        case Qt::Key_Shift: return Simulation::KEYS_SHIFT;
+        default: return Simulation::KEYS_NONE;
+    };
+}
+
+void RaceSession::keyPress(QKeyEvent* key) {
+    // A held key repeats as a release and a press, which a tick could land between
+    if(!simulation || key->isAutoRepeat()) return;
+
+    Qt::Key k = (Qt::Key)key->key();
+    switch(k) {
+    case Qt::Key_1:
+        simulation->send(Simulation::Input::CAMERA, Simulation::CHASE);
+        break;
+    case Qt::Key_2:
+        simulation->send(Simulation::Input::CAMERA, Simulation::PHOTO);
+        break;
+    case Qt::Key_3:
+        simulation->send(Simulation::Input::CAMERA, Simulation::OBSERVER);
+        break;
+
+    default: // It is either a tracked key, or one which will result in 0
+        if(getKey(k) != Simulation::KEYS_NONE) simulation->send(Simulation::Input::KEY_DOWN, getKey(k));
+        break;
+    }
+}
+
+void RaceSession::keyRelease(QKeyEvent* key) {
+    if(!simulation || key->isAutoRepeat()) return;
+    const int k = getKey((Qt::Key)key->key());
+    if(k != Simulation::KEYS_NONE) simulation->send(Simulation::Input::KEY_UP, k);
+}
+
+void RaceSession::mousePress(QMouseEvent* e) {
+    mouse_x = e->x();
+    mouse_y = e->y();
+}
+
+void RaceSession::mouseMove(QMouseEvent* e) {
+    // Only the observer looks around, the simulation knows which camera is active
+    if(simulation) simulation->send(Simulation::Input::LOOK, 0, e->x() - mouse_x, e->y() - mouse_y);
+
+    mouse_x = e->x();
+    mouse_y = e->y();
+}
+
+void RaceSession::resize(int width, int height) {
+    if(simulation) simulation->send(Simulation::Input::RESIZE, 0, width, height);
+}
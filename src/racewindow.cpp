@@ -0,0 +1,50 @@
+#include "racewindow.h"
+
+#include <QExposeEvent>
+#include <QResizeEvent>
+
+RaceWindow::RaceWindow(unsigned tick_hz) : session(tick_hz) {
+    setSurfaceType(QSurface::OpenGLSurface);
+    setFormat(QSurfaceFormat::defaultFormat());
+}
+
+void RaceWindow::exposeEvent(QExposeEvent*) {
+    if(!session.started()) {
+        if(!isExposed()) return;
+        // The window's native surface exists by its first expose
+        session.start(new RenderThread(this, session.world, session.shader, session.stats),
+                      width() * devicePixelRatio(), height() * devicePixelRatio());
+        return;
+    }
+    // Hidden or minimised windows are not drawn to at all
+    session.renderer->setExposed(isExposed());
+}
+
+void RaceWindow::resizeEvent(QResizeEvent*) {
+    // The viewport is in pixels, the window's size is not on high DPI screens
+    session.resize(width() * devicePixelRatio(), height() * devicePixelRatio());
+}
+
+void RaceWindow::keyPressEvent(QKeyEvent* key) {
+    session.keyPress(key);
+}
+
+void RaceWindow::keyReleaseEvent(QKeyEvent* key) {
+    session.keyRelease(key);
+}
+
+void RaceWindow::mousePressEvent(QMouseEvent* e) {
+    session.mousePress(e);
+}
+
+void RaceWindow::mouseMoveEvent(QMouseEvent* e) {
+    session.mouseMove(e);
+}
+
+void RaceWindow::focusInEvent(QFocusEvent*) {
+    session.setFocused(true);
+}
+
+void RaceWindow::focusOutEvent(QFocusEvent*) {
+    session.setFocused(false);
+}
@@ -0,0 +1,270 @@
+#include "renderthread.h"
+
+#include <QMetaObject>
+#include <algorithm>
+
+RenderThread::RenderThread(QOpenGLWidget* view, World& world, Shader& shader) :
+        view(view), window(nullptr), world(world), shader(shader), stats(nullptr) {
+    init(view->context(), view->context()->format());
+}
+
+RenderThread::RenderThread(QWindow* window, World& world, Shader& shader, FrameStats& stats) :
+        view(nullptr), window(window), world(world), shader(shader), stats(&stats) {
+    init(nullptr, window->format());
+}
+
+void RenderThread::init(QOpenGLContext* share, const QSurfaceFormat& format) {
+    gl = nullptr;
+    stopping = false;
+    reload_requested = false;
+    frame_requested = true;
+    redraw_requested = false;
+    have_snapshot = false;
+    settled = true;
+    exposed = true;
+    min_interval_ns = 0;
+    drawn_serial = 0;
+
+    for(unsigned x = 0; x < 3; ++x) {
+        FrameImage& image = images.slot(x);
+        image.fbo = image.texture = image.depth = 0;
+        image.width = image.height = 0;
+        image.written = image.read = 0;
+        image.draw_ms = 0.0;
+    }
+
+    context = new QOpenGLContext();
+    context->setFormat(format);
+    if(share != nullptr) context->setShareContext(share);
+    if(!context->create()) qFatal("Unable to create the render thread's context");
+    context->moveToThread(this);
+
+    // Surfaces have to be made on the GUI thread
+    if(window == nullptr) {
+        surface.setFormat(context->format());
+        surface.create();
+    }
+}
+
+RenderThread::~RenderThread() {
+    stop();
+    wait();
+}
+
+void RenderThread::publish() {
+    snapshots.publish();
+    // Otherwise the next requestFrame() picks it up
+    std::lock_guard<std::mutex> guard(lock);
+    if(frame_requested) wake.notify_one();
+}
+
+void RenderThread::requestFrame() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        frame_requested = true;
+    }
+    wake.notify_one();
+}
+
+void RenderThread::setExposed(bool now_exposed) {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        exposed = now_exposed;
+        // Whatever the window showed before is gone
+        if(exposed) redraw_requested = true;
+    }
+    wake.notify_one();
+}
+
+void RenderThread::setFrameCap(double fps) {
+    min_interval_ns = fps > 0.0 ? (int64_t)(1e9 / fps) : 0;
+}
+
+void RenderThread::requestReload() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        reload_requested = true;
+    }
+    wake.notify_one();
+}
+
+void RenderThread::stop() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        stopping = true;
+    }
+    wake.notify_one();
+}
+
+void RenderThread::run() {
+    if(window != nullptr) context->makeCurrent(window);
+    else context->makeCurrent(&surface);
+    gl = context->versionFunctions<QOpenGLFunctions_4_1_Core>();
+
+    try {
+        shader.compileStageFile("shaders/flat.vert");
+        shader.compileStageFile("shaders/flat.frag");
+        shader.link();
+        shader.use();
+    } catch(ShaderException &e) {
+        qFatal("Shader exception: %s \n%s", e.what(), e.getOpenGLLog().c_str());
+    }
+
+    gl->glClearColor(0.420f, 0.824f, 1.0f, 1.0f);
+    gl->glEnable(GL_DEPTH_TEST);
+    gl->glEnable(GL_POLYGON_OFFSET_FILL);
+    gl->glPolygonOffset(1.0f, 1.0f);
+
+    world.init();
+
+    std::chrono::steady_clock::time_point last_frame;
+    for(;;) {
+        bool reload;
+        bool frame;
+        {
+            std::unique_lock<std::mutex> guard(lock);
+            wake.wait(guard, [this]() {
+                return stopping || reload_requested ||
+                       (frame_requested && exposed && (!settled || redraw_requested || snapshots.pending()));
+            });
+            if(stopping) break;
+            reload = reload_requested;
+            reload_requested = false;
+            if(snapshots.update()) {
+                have_snapshot = true;
+                settled = false;
+            }
+            // The lights or props may have changed, an exposed window needs drawing again
+            if((reload || redraw_requested) && have_snapshot) settled = false;
+            redraw_requested = false;
+            frame = frame_requested && exposed && !settled;
+            if(frame) frame_requested = false;
+        }
+        if(reload) world.reload();
+        if(!frame) continue;
+
+        // Hold the frame back to keep under the cap, a newer snapshot may arrive meanwhile
+        const std::chrono::nanoseconds interval(min_interval_ns.load());
+        if(interval.count() > 0 && std::chrono::steady_clock::now() < last_frame + interval) {
+            std::unique_lock<std::mutex> guard(lock);
+            if(wake.wait_until(guard, last_frame + interval, [this]() { return stopping; })) break;
+            snapshots.update();
+        }
+        last_frame = std::chrono::steady_clock::now();
+
+        const FrameSnapshot& snapshot = snapshots.front();
+        if(window != nullptr) {
+            settled = drawWindow(snapshot);
+            // The swap waited for the display, so the window is ready for another
+            std::lock_guard<std::mutex> guard(lock);
+            frame_requested = true;
+        } else {
+            settled = drawImage(snapshot, images.back());
+            images.publish();
+            QMetaObject::invokeMethod(view, "update", Qt::QueuedConnection);
+        }
+        drawn_serial = snapshot.serial;
+    }
+
+    for(unsigned x = 0; x < 3; ++x) {
+        FrameImage& image = images.slot(x);
+        if(image.written != 0) gl->glDeleteSync(image.written);
+        if(image.read != 0) gl->glDeleteSync(image.read);
+        gl->glDeleteFramebuffers(1, &image.fbo);
+        gl->glDeleteTextures(1, &image.texture);
+        gl->glDeleteRenderbuffers(1, &image.depth);
+    }
+    context->doneCurrent();
+    delete context;
+}
+
+void RenderThread::resize(FrameImage& image, int width, int height) {
+    if(image.fbo != 0 && image.width == width && image.height == height) return;
+
+    if(image.fbo == 0) {
+        gl->glGenFramebuffers(1, &image.fbo);
+        gl->glGenTextures(1, &image.texture);
+        gl->glGenRenderbuffers(1, &image.depth);
+    }
+    image.width = width;
+    image.height = height;
+
+    gl->glBindTexture(GL_TEXTURE_2D, image.texture);
+    gl->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    gl->glBindRenderbuffer(GL_RENDERBUFFER, image.depth);
+    gl->glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+
+    gl->glBindFramebuffer(GL_FRAMEBUFFER, image.fbo);
+    gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, image.texture, 0);
+    gl->glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, image.depth);
+    if(gl->glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        qFatal("Frame image framebuffer is incomplete");
+}
+
+bool RenderThread::draw(const FrameSnapshot& frame, int width, int height) {
+    gl->glViewport(0, 0, width, height);
+    gl->glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    // A tick behind, so there is always a later state to blend towards
+    const std::chrono::duration<float> since = std::chrono::steady_clock::now() - frame.time;
+    const std::chrono::duration<float> tick = frame.tick;
+    const float t = glm::clamp(since.count() / tick.count(), 0.0f, 1.0f);
+    const Camera camera = Camera::interpolate(frame.previous.camera, frame.current.camera, t);
+    const glm::mat4 car = MobileEntity::interpolate(frame.previous.car, frame.current.car, t);
+
+    const glm::mat4& proj = camera.getProjectionMatrix();
+    const glm::mat4& view_matrix = camera.getViewMatrix();
+    shader.setUniform("proj", proj);
+    shader.setUniform("view", view_matrix);
+    world.setLightUniforms(view_matrix);
+    shader.setUniform("show_back_facing", false);
+
+    gl->glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+    shader.setUniform("black_overide", false);
+    world.render(proj * view_matrix, camera.getPosition(), car);
+    return t >= 1.0f;
+}
+
+bool RenderThread::drawImage(const FrameSnapshot& frame, FrameImage& image) {
+    const std::chrono::steady_clock::time_point began = std::chrono::steady_clock::now();
+
+    // The widget may still be copying this image out
+    if(image.read != 0) {
+        gl->glWaitSync(image.read, 0, GL_TIMEOUT_IGNORED);
+        gl->glDeleteSync(image.read);
+        image.read = 0;
+    }
+    // Published before, but replaced before the widget got to it
+    if(image.written != 0) {
+        gl->glDeleteSync(image.written);
+        image.written = 0;
+    }
+
+    resize(image, std::max(frame.width, 1), std::max(frame.height, 1));
+    gl->glBindFramebuffer(GL_FRAMEBUFFER, image.fbo);
+    const bool at_rest = draw(frame, image.width, image.height);
+
+    // Flushed so the widget's context can wait on it
+    image.written = gl->glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    gl->glFlush();
+
+    image.input = frame.input;
+    image.draw_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - began).count();
+    return at_rest;
+}
+
+bool RenderThread::drawWindow(const FrameSnapshot& frame) {
+    const std::chrono::steady_clock::time_point began = std::chrono::steady_clock::now();
+
+    gl->glBindFramebuffer(GL_FRAMEBUFFER, context->defaultFramebufferObject());
+    const bool at_rest = draw(frame, std::max(frame.width, 1), std::max(frame.height, 1));
+    const std::chrono::steady_clock::time_point drawn = std::chrono::steady_clock::now();
+
+    context->swapBuffers(window);
+    stats->add(std::chrono::duration<double, std::milli>(drawn - began).count(),
+               std::chrono::steady_clock::now(), frame.input);
+    return at_rest;
+}
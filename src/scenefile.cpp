@@ -0,0 +1,239 @@
+#include "scenefile.h"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "sourcestamp.h"
+
+#define REF(t, x) ((float)t[x].toDouble())
+
+namespace {
+    const char     MAGIC[4] = { 'R', 'S', 'C', 'N' };
+    /// Version of the file layout, bump whenever it or the data stored changes
+    const uint32_t FORMAT_VERSION = 1;
+    /// Every array starts on a multiple of this
+    const size_t   SECTION_ALIGNMENT = 16;
+
+    struct Header {
+        char     magic[4];
+        uint32_t version;
+        /// Identifies the JSON the scene was compiled from, if has_source
+        SourceStamp source;
+        uint32_t has_source;
+        SceneFile::Globals globals;
+        uint32_t trees;
+        uint32_t buildings;
+        uint32_t lamps;
+        uint32_t left_curb;
+        uint32_t right_curb;
+    };
+
+    /// Byte offsets of each array, in file order
+    struct Layout {
+        size_t tree_positions, tree_heights, building_outlines, building_heights,
+               lamp_positions, lamp_heights, left_curb, right_curb, end;
+
+        explicit Layout(const Header& h) {
+            const auto next = [](size_t offset, size_t floats) {
+                offset += floats * sizeof(float);
+                return (offset + SECTION_ALIGNMENT - 1) / SECTION_ALIGNMENT * SECTION_ALIGNMENT;
+            };
+            tree_positions    = next(sizeof(Header), 0);
+            tree_heights      = next(tree_positions,    (size_t)h.trees * 3);
+            building_outlines = next(tree_heights,      (size_t)h.trees);
+            building_heights  = next(building_outlines, (size_t)h.buildings * 12);
+            lamp_positions    = next(building_heights,  (size_t)h.buildings * 4);
+            lamp_heights      = next(lamp_positions,    (size_t)h.lamps * 3);
+            left_curb         = next(lamp_heights,      (size_t)h.lamps);
+            right_curb        = next(left_curb,         (size_t)h.left_curb);
+            end               = right_curb + (size_t)h.right_curb * sizeof(float);
+        }
+    };
+
+    void readVec3(const QJsonArray& a, float* out) {
+        for(int x = 0; x < 3; ++x) out[x] = REF(a, x);
+    }
+
+    void readCurb(const QJsonArray& curb, const char* side, std::vector<float>& out) {
+        for(auto&& i : curb) {
+            if(!i.isDouble())
+                throw std::invalid_argument(std::string("Track found invalid data within ") + side + " curb.");
+            out.push_back((float)i.toDouble());
+        }
+    }
+}
+
+SceneFile::View SceneFile::Scene::view() const {
+    View v;
+    v.globals = globals;
+    v.tree_count = tree_heights.size();
+    v.tree_positions = tree_positions.data();
+    v.tree_heights = tree_heights.data();
+    v.building_count = building_heights.size() / 4;
+    v.building_outlines = building_outlines.data();
+    v.building_heights = building_heights.data();
+    v.lamp_count = lamp_heights.size();
+    v.lamp_positions = lamp_positions.data();
+    v.lamp_heights = lamp_heights.data();
+    v.left_curb_count = left_curb.size();
+    v.right_curb_count = right_curb.size();
+    v.left_curb = left_curb.data();
+    v.right_curb = right_curb.data();
+    return v;
+}
+
+void SceneFile::Scene::assign(const View& v) {
+    globals = v.globals;
+    tree_positions.assign(v.tree_positions, v.tree_positions + (size_t)v.tree_count * 3);
+    tree_heights.assign(v.tree_heights, v.tree_heights + v.tree_count);
+    building_outlines.assign(v.building_outlines, v.building_outlines + (size_t)v.building_count * 12);
+    building_heights.assign(v.building_heights, v.building_heights + (size_t)v.building_count * 4);
+    lamp_positions.assign(v.lamp_positions, v.lamp_positions + (size_t)v.lamp_count * 3);
+    lamp_heights.assign(v.lamp_heights, v.lamp_heights + v.lamp_count);
+    left_curb.assign(v.left_curb, v.left_curb + v.left_curb_count);
+    right_curb.assign(v.right_curb, v.right_curb + v.right_curb_count);
+}
+
+bool SceneFile::parseJson(const std::string& file_name, Scene& scene) {
+    QFile json_data(file_name.c_str());
+    if(!json_data.open(QIODevice::ReadOnly)) return false;
+
+    QJsonParseError err;
+    QJsonObject json = QJsonDocument::fromJson(json_data.readAll(), &err).object();
+
+    scene = Scene();
+    Globals& g = scene.globals;
+
+    QJsonArray adata = json["bbox"].toArray();
+    for(int x = 0; x < 3; ++x) {
+        g.bbox_min[x] = REF(adata, x);
+        g.bbox_max[x] = REF(adata, x + 3);
+    }
+    readVec3(json["startPosition"].toArray(), g.start_position);
+    readVec3(json["startPYR"].toArray(), g.start_pyr);
+    readVec3(json["photoPosition"].toArray(), g.photo_position);
+    readVec3(json["observerPosition"].toArray(), g.observer_position);
+    readVec3(json["weather"].toObject()["sunLightDirection"].toArray(), g.sun_direction);
+    readVec3(json["weather"].toObject()["sunIntensity"].toArray(), g.sun_intensity);
+    readVec3(json["lampIntensity"].toArray(), g.lamp_intensity);
+
+    QJsonObject track = json["track"].toObject();
+    if(!track.contains("leftCurb") || !track.contains("rightCurb"))
+        throw std::invalid_argument("Track did not recieve a QJsonObject with left and right curb.");
+    if(!track["leftCurb"].isArray() || !track["rightCurb"].isArray())
+        throw std::invalid_argument("Track did not recieve a QJsonObject with curb arrays.");
+    readCurb(track["leftCurb"].toArray(), "left", scene.left_curb);
+    readCurb(track["rightCurb"].toArray(), "right", scene.right_curb);
+
+    // Optional, "gpu" renders the normal map instead of generating it on the CPU
+    if(track.value("textures").toString() == "gpu") g.track_flags |= TRACK_GPU_TEXTURES;
+    if(track.value("verifyTextures").toBool())       g.track_flags |= TRACK_VERIFY_TEXTURES;
+
+    for(auto&& i : json["trees"].toArray()) {
+        QJsonObject t = i.toObject();
+        QJsonArray pos = t["position"].toArray();
+        for(int x = 0; x < 3; ++x) scene.tree_positions.push_back(REF(pos, x));
+        scene.tree_heights.push_back(REF(t, "height"));
+    }
+
+    // Each corner of the outline is x, y, z and then the height above it
+    for(auto&& i : json["buildings"].toArray()) {
+        QJsonArray t = i.toObject()["outline"].toArray();
+        for(int c = 0; c < 4; ++c) {
+            for(int x = 0; x < 3; ++x) scene.building_outlines.push_back(REF(t, c * 4 + x));
+            scene.building_heights.push_back(REF(t, c * 4 + 3));
+        }
+    }
+
+    for(auto&& i : json["lamps"].toArray()) {
+        QJsonObject t = i.toObject();
+        QJsonArray pos = t["position"].toArray();
+        for(int x = 0; x < 3; ++x) scene.lamp_positions.push_back(REF(pos, x));
+        scene.lamp_heights.push_back(REF(t, "height"));
+    }
+    return true;
+}
+
+std::string SceneFile::pathFor(const std::string& source) {
+    return source + ".scene";
+}
+
+bool SceneFile::load(const std::string& path, MappedFile& file, View& view, const std::string& source) {
+    if(!file.open(path)) return false;
+
+    Header head;
+    if(file.size() < sizeof(head)) return false;
+    std::memcpy(&head, file.data(), sizeof(head));
+    if(!std::equal(MAGIC, MAGIC + 4, head.magic) || head.version != FORMAT_VERSION) return false;
+    if(!source.empty() && (!head.has_source || !head.source.matches(source))) return false;
+
+    const Layout layout(head);
+    if(layout.end != file.size()) return false;
+
+    const uint8_t* base = file.data();
+    const auto floats = [base](size_t offset) { return reinterpret_cast<const float*>(base + offset); };
+    view.globals = head.globals;
+    view.tree_count = head.trees;
+    view.tree_positions = floats(layout.tree_positions);
+    view.tree_heights = floats(layout.tree_heights);
+    view.building_count = head.buildings;
+    view.building_outlines = floats(layout.building_outlines);
+    view.building_heights = floats(layout.building_heights);
+    view.lamp_count = head.lamps;
+    view.lamp_positions = floats(layout.lamp_positions);
+    view.lamp_heights = floats(layout.lamp_heights);
+    view.left_curb_count = head.left_curb;
+    view.right_curb_count = head.right_curb;
+    view.left_curb = floats(layout.left_curb);
+    view.right_curb = floats(layout.right_curb);
+    return true;
+}
+
+bool SceneFile::save(const std::string& path, const View& scene, const std::string& source) {
+    Header head;
+    std::memset(&head, 0, sizeof(head));
+    std::copy(MAGIC, MAGIC + 4, head.magic);
+    head.version = FORMAT_VERSION;
+    if(!source.empty()) {
+        if(!SourceStamp::of(source, head.source)) return false;
+        head.has_source = 1;
+    }
+    head.globals = scene.globals;
+    head.trees = scene.tree_count;
+    head.buildings = scene.building_count;
+    head.lamps = scene.lamp_count;
+    head.left_curb = scene.left_curb_count;
+    head.right_curb = scene.right_curb_count;
+
+    // Lay the sections out in one buffer, padding included, then write it at once
+    const Layout layout(head);
+    std::vector<uint8_t> out(layout.end, 0);
+    const auto place = [&out](size_t offset, const float* src, size_t floats) {
+        if(floats > 0) std::memcpy(&out[offset], src, floats * sizeof(float));
+    };
+    std::memcpy(&out[0], &head, sizeof(head));
+    place(layout.tree_positions, scene.tree_positions, (size_t)head.trees * 3);
+    place(layout.tree_heights, scene.tree_heights, head.trees);
+    place(layout.building_outlines, scene.building_outlines, (size_t)head.buildings * 12);
+    place(layout.building_heights, scene.building_heights, (size_t)head.buildings * 4);
+    place(layout.lamp_positions, scene.lamp_positions, (size_t)head.lamps * 3);
+    place(layout.lamp_heights, scene.lamp_heights, head.lamps);
+    place(layout.left_curb, scene.left_curb, head.left_curb);
+    place(layout.right_curb, scene.right_curb, head.right_curb);
+
+    // Written to a temporary first so a crash never leaves a half written scene
+    const std::string tmp = path + ".tmp";
+    {
+        std::ofstream file(tmp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if(!file || !file.write((const char*)&out[0], out.size())) return false;
+    }
+    std::remove(path.c_str());
+    return std::rename(tmp.c_str(), path.c_str()) == 0;
+}
@@ -222,6 +222,15 @@ void Shader::setUniform( const char * name, GLfloat val) {
 	gl->glUniform1f( getUniformLocation(name), val);
 }
 
+void Shader::setUniformBlock( const char * name, GLuint binding) {
+	QOpenGLFunctions_4_1_Core* gl =
+		QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_4_1_Core>();
+
+	GLuint index = gl->glGetUniformBlockIndex( m_programId, name );
+	if( index != GL_INVALID_INDEX )
+		gl->glUniformBlockBinding( m_programId, index, binding );
+}
+
 void Shader::destroy()
 {
 	if( m_programId != 0 )
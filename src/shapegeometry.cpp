@@ -0,0 +1,15 @@
+#include "shapegeometry.h"
+
+MeshData ShapeGeometry::scaled(const View& view, glm::vec3 position_scale, glm::vec3 normal_scale) {
+    MeshData data;
+    data.positions.resize(3 * view.vertices);
+    data.normals.resize(3 * view.vertices);
+    for(GLuint v = 0; v < view.vertices; ++v) {
+        for(int c = 0; c < 3; ++c) {
+            data.positions[3 * v + c] = view.positions[3 * v + c] * position_scale[c];
+            data.normals[3 * v + c] = view.normals[3 * v + c] * normal_scale[c];
+        }
+    }
+    data.indices.assign(view.indices, view.indices + view.index_count);
+    return data;
+}
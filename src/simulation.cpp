@@ -0,0 +1,196 @@
+#include "simulation.h"
+
+#include <chrono>
+
+const unsigned Simulation::DEFAULT_HZ;
+const unsigned Simulation::MAX_CATCH_UP;
+constexpr float Simulation::CAR_SPEED;
+constexpr float Simulation::CAR_TURN;
+constexpr float Simulation::OBSERVER_SPEED;
+
+Simulation::Simulation(World& world, RenderThread& renderer, unsigned hz) :
+        world(world), renderer(renderer), hz(hz == 0 ? DEFAULT_HZ : hz), stopping(false),
+        camera_mode(CHASE), depressed_keys(KEYS_NONE), width(0), height(0), serial(0), input_serial(0) {
+    observer.orient( //initial observer position
+        world.observerPosition(),
+        world.car->getPosition(), // at
+        glm::vec3(0.0f, 1.0f, 0.0f) // up
+    );
+    orientChase();
+    orientPhoto();
+    current.camera = chase;
+    current.car = world.car->getMobTransform();
+    previous = current;
+}
+
+Simulation::~Simulation() {
+    stop();
+}
+
+void Simulation::start() {
+    if(thread.joinable()) return;
+    stopping = false;
+    thread = std::thread(&Simulation::run, this);
+}
+
+void Simulation::stop() {
+    stopping = true;
+    if(thread.joinable()) thread.join();
+}
+
+void Simulation::send(Input::Type type, int value, float x, float y) {
+    Input input;
+    input.type = type;
+    input.value = value;
+    input.x = x;
+    input.y = y;
+    input.time = std::chrono::steady_clock::now();
+    if(!inputs.push(input)) qWarning("Simulation input queue is full, dropped an event");
+}
+
+void Simulation::run() {
+    typedef std::chrono::steady_clock Clock;
+    const Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / hz));
+    const float dt = 1.0f / hz;
+
+    Clock::time_point last = Clock::now();
+    Clock::duration unsimulated(0);
+    while(!stopping) {
+        const Clock::time_point now = Clock::now();
+        unsimulated += now - last;
+        last = now;
+        // After a stall, e.g. a debugger, skip ahead rather than race to catch up
+        if(unsimulated > MAX_CATCH_UP * period) unsimulated = MAX_CATCH_UP * period;
+
+        // The renderer keeps showing the last snapshot until something moves
+        bool changed = false;
+        while(unsimulated >= period) {
+            changed |= tick(dt);
+            unsimulated -= period;
+        }
+        if(changed) publish(now - unsimulated, period);
+
+        std::this_thread::sleep_until(now + (period - unsimulated));
+    }
+}
+
+bool Simulation::tick(float dt) {
+    Input in;
+    std::chrono::steady_clock::time_point first_input;
+    const CameraMode was = camera_mode;
+    const int was_width = width, was_height = height;
+    if(input != std::chrono::steady_clock::time_point() && renderer.drawnSerial() >= input_serial)
+        input = std::chrono::steady_clock::time_point();
+    while(inputs.pop(in)) {
+        // Only input with an effect to see counts towards latency
+        if(apply(in) && first_input == std::chrono::steady_clock::time_point()) first_input = in.time;
+    }
+
+    if(camera_mode == CHASE || camera_mode == PHOTO) {
+        if(depressed_keys & KEYS_W) world.car->move(CAR_SPEED * dt);
+        if(depressed_keys & KEYS_S) world.car->move(-CAR_SPEED * dt);
+        if(depressed_keys & KEYS_A) world.car->turn(-CAR_TURN * dt);
+        if(depressed_keys & KEYS_D) world.car->turn(CAR_TURN * dt);
+    }
+    else if(camera_mode == OBSERVER) {
+        const float step = OBSERVER_SPEED * dt;
+        if(depressed_keys & KEYS_W) observer.slideXZ(step * glm::vec3(0.0f, 0.0f, -1.0f));
+        if(depressed_keys & KEYS_S) observer.slideXZ(step * glm::vec3(0.0f, 0.0f, 1.0f));
+        if(depressed_keys & KEYS_A) observer.slideXZ(step * glm::vec3(-1.0f, 0.0f, 0.0f));
+        if(depressed_keys & KEYS_D) observer.slideXZ(step * glm::vec3(1.0f, 0.0f, 0.0f));
+        if(depressed_keys & KEYS_SHIFT) observer.slideY(step * glm::vec3(0.0f, -1.0f, 0.0f));
+        if(depressed_keys & KEYS_SPACE) observer.slideY(step * glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+
+    if(depressed_keys) { //no change if no movement
+        if(camera_mode == CHASE)
+            orientChase();
+        if(camera_mode == PHOTO)
+            orientPhoto();
+    }
+
+    previous = current;
+    if(camera_mode == PHOTO) current.camera = photo;
+    else if(camera_mode == OBSERVER) current.camera = observer;
+    else current.camera = chase;
+    current.car = world.car->getMobTransform();
+    // Cut to a new camera, rather than swing over from the old one
+    if(camera_mode != was) previous.camera = current.camera;
+
+    const bool changed = camera_mode != was || width != was_width || height != was_height ||
+                         current.car != previous.car ||
+                         current.camera.getViewMatrix() != previous.camera.getViewMatrix();
+    // Input which changed nothing is not waited for
+    if(changed && input == std::chrono::steady_clock::time_point()) {
+        input = first_input;
+        input_serial = serial + 1;
+    }
+    return changed;
+}
+
+void Simulation::publish(std::chrono::steady_clock::time_point time, std::chrono::steady_clock::duration tick) {
+    // Nothing to draw into before the view has a size
+    if(width <= 0 || height <= 0) return;
+
+    FrameSnapshot& frame = renderer.snapshots.back();
+    frame.serial = ++serial;
+    frame.input = input;
+    frame.previous = previous;
+    frame.current = current;
+    frame.time = time;
+    frame.tick = tick;
+    frame.width = width;
+    frame.height = height;
+    renderer.publish();
+}
+
+bool Simulation::apply(const Input& in) {
+    switch(in.type) {
+    case Input::KEY_DOWN: {
+        const int was = depressed_keys;
+        depressed_keys |= in.value;
+        return depressed_keys != was;
+    }
+    case Input::KEY_UP: {
+        const int was = depressed_keys;
+        depressed_keys &= ~in.value;
+        return depressed_keys != was;
+    }
+    case Input::CAMERA: {
+        const CameraMode was = camera_mode;
+        camera_mode = (CameraMode)in.value;
+        return camera_mode != was;
+    }
+    case Input::LOOK:
+        if(camera_mode != OBSERVER || (in.x == 0.0f && in.y == 0.0f)) return false;
+        observer.rotate(in.x / 400.0f, glm::vec3(0.0f, 1.0f, 0.0f));
+        observer.pitch(in.y / 400.0f);
+        return true;
+    case Input::RESIZE:
+        if((int)in.x == width && (int)in.y == height) return false;
+        width = (int)in.x;
+        height = (int)in.y;
+        if(height > 0) {
+            const float a = in.x / in.y;
+            chase.setAspect(a);
+            photo.setAspect(a);
+            observer.setAspect(a);
+        }
+        return true;
+    }
+    return false;
+}
+
+void Simulation::orientChase() {
+    glm::vec3 pos = world.car->getPosition();
+    glm::vec3 dir = world.car->getDirection();
+    glm::vec3 at = pos + dir * 10.0f; // have it look at something ahead of the car
+    pos += dir * -6.0f; // have it positioned behind car
+    pos.y = 3.0f; // have it positioned above car
+    chase.orient(pos, at, glm::vec3(0.0f, 1.0f, 0.0f));
+}
+
+void Simulation::orientPhoto() {
+    photo.orient(world.photoPosition(), world.car->getPosition(), glm::vec3(0.0f, 1.0f, 0.0f));
+}
@@ -0,0 +1,42 @@
+#include "sourcestamp.h"
+
+#include <QFileInfo>
+#include <cstring>
+
+#include "mappedfile.h"
+
+bool SourceStamp::of(const std::string& source, SourceStamp& stamp) {
+    MappedFile file;
+    if(!file.open(source)) return false;
+    QFileInfo info(source.c_str());
+    stamp.size = file.size();
+    stamp.mtime = info.lastModified().toMSecsSinceEpoch();
+    stamp.hash = hashBytes(file.data(), file.size());
+    return true;
+}
+
+bool SourceStamp::matches(const std::string& source) const {
+    QFileInfo info(source.c_str());
+    if(!info.exists() || (uint64_t)info.size() != size) return false;
+    if(info.lastModified().toMSecsSinceEpoch() == mtime) return true;
+
+    // Reading the source is what the caches are there to avoid, so only when in doubt
+    MappedFile src;
+    return src.open(source) && hashBytes(src.data(), src.size()) == hash;
+}
+
+uint64_t SourceStamp::hashBytes(const uint8_t* data, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+    size_t x = 0;
+    for(; x + 8 <= len; x += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + x, 8);
+        h ^= word;
+        h *= 1099511628211ULL;
+    }
+    for(; x < len; ++x) {
+        h ^= data[x];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
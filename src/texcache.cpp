@@ -0,0 +1,169 @@
+#include "texcache.h"
+
+#include <QDir>
+#include <QFileInfo>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+namespace {
+    const char     MAGIC[4] = { 'R', 'T', 'E', 'X' };
+    /// Version of the file layout itself (not of the generators)
+    const uint32_t FORMAT_VERSION = 2;
+
+    struct Header {
+        char     magic[4];
+        uint32_t version;
+        uint64_t key;
+        uint32_t width;
+        uint32_t height;
+        uint32_t block_size;
+        uint32_t block_bytes;
+        uint32_t internal_format;
+        uint32_t format;
+        uint32_t levels;
+    };
+
+    /// FNV-1a
+    uint64_t hashBytes(const void* data, size_t len, uint64_t h) {
+        const uint8_t* bytes = (const uint8_t*)data;
+        for(size_t x = 0; x < len; ++x) {
+            h ^= bytes[x];
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+}
+
+size_t TextureCache::Image::levelSize(uint32_t level) const {
+    uint32_t w = std::max(1u, width >> level);
+    uint32_t h = std::max(1u, height >> level);
+    w = (w + block_size - 1) / block_size;
+    h = (h + block_size - 1) / block_size;
+    return (size_t)w * h * block_bytes;
+}
+
+uint64_t TextureCache::makeKey(const std::string& generator, uint32_t version, uint32_t x, uint32_t y) {
+    uint64_t h = 14695981039346656037ULL;
+    h = hashBytes(generator.data(), generator.size(), h);
+    h = hashBytes(&version, sizeof(version), h);
+    h = hashBytes(&x, sizeof(x), h);
+    h = hashBytes(&y, sizeof(y), h);
+    return h;
+}
+
+void TextureCache::buildMipChain(Image& img, uint8_t* (*downsample)(uint32_t, uint32_t, const uint8_t*)) {
+    if(img.levels.size() != 1) throw std::invalid_argument("buildMipChain expected an image with only a base level");
+
+    uint32_t w = img.width;
+    uint32_t h = img.height;
+    while(w > 1 || h > 1) {
+        uint8_t* next = downsample(w, h, &img.levels.back()[0]);
+        w = std::max(1u, w / 2);
+        h = std::max(1u, h / 2);
+        img.levels.push_back(std::vector<uint8_t>(next, next + img.levelSize(img.levels.size())));
+        delete[] next;
+    }
+}
+
+void TextureCache::encode(Image& img, GLenum internal_format, GLenum format, uint32_t block_size,
+                          uint32_t block_bytes, uint8_t* (*encode)(uint32_t, uint32_t, const uint8_t*)) {
+    if(img.isCompressed()) throw std::invalid_argument("encode expected an uncompressed image");
+
+    Image result = img;
+    result.internal_format = internal_format;
+    result.format = format;
+    result.block_size = block_size;
+    result.block_bytes = block_bytes;
+
+    for(uint32_t x = 0; x < img.levels.size(); ++x) {
+        uint32_t w = std::max(1u, img.width >> x);
+        uint32_t h = std::max(1u, img.height >> x);
+        uint8_t* data = encode(w, h, &img.levels[x][0]);
+        result.levels[x].assign(data, data + result.levelSize(x));
+        delete[] data;
+    }
+
+    img = std::move(result);
+}
+
+bool TextureCache::load(const std::string& file_name, uint64_t key, Image& img) {
+    std::ifstream in(file_name.c_str(), std::ios::in | std::ios::binary);
+    if(!in) return false;
+
+    Header head;
+    if(!in.read((char*)&head, sizeof(head))) return false;
+    if(!std::equal(MAGIC, MAGIC + 4, head.magic) || head.version != FORMAT_VERSION || head.key != key ||
+       head.block_size == 0)
+        return false;
+
+    Image tmp;
+    tmp.width = head.width;
+    tmp.height = head.height;
+    tmp.block_size = head.block_size;
+    tmp.block_bytes = head.block_bytes;
+    tmp.internal_format = head.internal_format;
+    tmp.format = head.format;
+    tmp.levels.resize(head.levels);
+
+    for(uint32_t x = 0; x < head.levels; ++x) {
+        uint64_t size = 0;
+        if(!in.read((char*)&size, sizeof(size)) || size != tmp.levelSize(x)) return false;
+        tmp.levels[x].resize(size);
+        if(!in.read((char*)&tmp.levels[x][0], size)) return false;
+    }
+
+    img = std::move(tmp);
+    return true;
+}
+
+bool TextureCache::save(const std::string& file_name, uint64_t key, const Image& img) {
+    QDir().mkpath(QFileInfo(file_name.c_str()).path());
+
+    std::ofstream out(file_name.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    if(!out) return false;
+
+    Header head;
+    std::copy(MAGIC, MAGIC + 4, head.magic);
+    head.version = FORMAT_VERSION;
+    head.key = key;
+    head.width = img.width;
+    head.height = img.height;
+    head.block_size = img.block_size;
+    head.block_bytes = img.block_bytes;
+    head.internal_format = img.internal_format;
+    head.format = img.format;
+    head.levels = img.levels.size();
+    out.write((const char*)&head, sizeof(head));
+
+    for(auto&& level : img.levels) {
+        uint64_t size = level.size();
+        out.write((const char*)&size, sizeof(size));
+        out.write((const char*)&level[0], size);
+    }
+
+    return (bool)out;
+}
+
+void TextureCache::upload(QOpenGLFunctions_4_1_Core* gl, const Image& img) {
+    GLint levels = img.levels.size();
+
+    gl->glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                        levels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+
+    for(GLint x = 0; x < levels; ++x) {
+        GLsizei w = std::max(1u, img.width >> x);
+        GLsizei h = std::max(1u, img.height >> x);
+        if(img.isCompressed())
+            gl->glCompressedTexImage2D(GL_TEXTURE_2D, x, img.internal_format, w, h, 0,
+                                       img.levels[x].size(), &img.levels[x][0]);
+        else
+            gl->glTexImage2D(GL_TEXTURE_2D, x, img.internal_format, w, h, 0,
+                             img.format, GL_UNSIGNED_BYTE, &img.levels[x][0]);
+    }
+    gl->glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
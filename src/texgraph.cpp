@@ -0,0 +1,375 @@
+#include "texgraph.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#include "heightkernel.h"
+#include "threadpool.h"
+
+namespace {
+    /// Tiles are small enough that every core gets several of a 512x512 image
+    const uint32_t TILE_SIZE = 128;
+
+    inline uint8_t* align(uint8_t* raw) {
+        const uintptr_t mask = TexGraph::BufferPool::ALIGNMENT - 1;
+        return reinterpret_cast<uint8_t*>((reinterpret_cast<uintptr_t>(raw) + mask) & ~mask);
+    }
+
+    class Noise : public TexGraph::Node {
+    public:
+        Noise() : Node("noise", {}) {}
+        uint32_t channels() const { return 1; }
+
+        void run(const std::vector<const TexGraph::Image*>&, TexGraph::Image& out) const {
+            const HeightKernel::RowFunction row = HeightKernel::heightRow();
+            TexGraph::forEachTile(out.width, out.height, [&](const TexGraph::Tile& t) {
+                for(uint32_t x = t.row; x < t.row + t.rows; ++x)
+                    row(x, t.column, t.columns, out.floats() + (size_t)x * out.width + t.column);
+            });
+        }
+    };
+
+    class Combine : public TexGraph::Node {
+        float weight_a, weight_b;
+
+    public:
+        Combine(TexGraph::NodePtr a, TexGraph::NodePtr b, float weight_a, float weight_b) :
+            Node("combine", {a, b}), weight_a(weight_a), weight_b(weight_b) {
+            mix(weight_a);
+            mix(weight_b);
+        }
+        uint32_t channels() const { return inputs()[0]->channels(); }
+
+        void run(const std::vector<const TexGraph::Image*>& in, TexGraph::Image& out) const {
+            const float* a = in[0]->floats();
+            const float* b = in[1]->floats();
+            float* o = out.floats();
+            const uint32_t c = out.channels;
+            TexGraph::forEachTile(out.width, out.height, [&](const TexGraph::Tile& t) {
+                for(uint32_t x = t.row; x < t.row + t.rows; ++x) {
+                    const size_t begin = ((size_t)x * out.width + t.column) * c;
+                    const size_t end = begin + (size_t)t.columns * c;
+                    for(size_t i = begin; i < end; ++i)
+                        o[i] = a[i] * weight_a + b[i] * weight_b;
+                }
+            });
+        }
+    };
+
+    class Remap : public TexGraph::Node {
+        float low, high;
+        uint32_t levels;
+
+    public:
+        Remap(TexGraph::NodePtr in, float low, float high, uint32_t levels) :
+            Node("remap", {in}), low(low), high(high), levels(levels) {
+            mix(low);
+            mix(high);
+            mix(levels);
+        }
+        uint32_t channels() const { return 1; }
+
+        void run(const std::vector<const TexGraph::Image*>& in, TexGraph::Image& out) const {
+            const float* src = in[0]->floats();
+            float* dst = out.floats();
+
+            // First find the range of the whole input
+            float min = 1e10f, max = -1e10f;
+            std::mutex lock;
+            TexGraph::forEachTile(out.width, out.height, [&](const TexGraph::Tile& t) {
+                float tile_min = 1e10f, tile_max = -1e10f;
+                for(uint32_t x = t.row; x < t.row + t.rows; ++x) {
+                    const float* line = src + (size_t)x * out.width;
+                    for(uint32_t y = t.column; y < t.column + t.columns; ++y) {
+                        tile_min = std::min(tile_min, line[y]);
+                        tile_max = std::max(tile_max, line[y]);
+                    }
+                }
+                std::lock_guard<std::mutex> guard(lock);
+                min = std::min(min, tile_min);
+                max = std::max(max, tile_max);
+            });
+            const float range = max - min;
+
+            TexGraph::forEachTile(out.width, out.height, [&](const TexGraph::Tile& t) {
+                for(uint32_t x = t.row; x < t.row + t.rows; ++x) {
+                    const size_t line = (size_t)x * out.width;
+                    for(uint32_t y = t.column; y < t.column + t.columns; ++y) {
+                        if(range == 0.0f) {
+                            dst[line + y] = low;
+                            continue;
+                        }
+                        float val = src[line + y] - min;
+                        val /= range;
+                        // (uint8_t)(255.0f * val) / 255.0f for 256 levels, like generateHeightMap
+                        if(levels > 1)
+                            val = (float)(uint32_t)((levels - 1) * val) / (float)(levels - 1);
+                        dst[line + y] = low + val * (high - low);
+                    }
+                }
+            });
+        }
+    };
+
+    class DeriveNormal : public TexGraph::Node {
+    public:
+        explicit DeriveNormal(TexGraph::NodePtr heights) : Node("derive-normal", {heights}) {}
+        uint32_t channels() const { return 3; }
+
+        // The same sums as NormalKernel::rowSSE2, over floats rather than bytes
+        void run(const std::vector<const TexGraph::Image*>& in, TexGraph::Image& out) const {
+            const uint32_t w = out.width, h = out.height;
+            const float* src = in[0]->floats();
+            float* dst = out.floats();
+
+            TexGraph::forEachTile(w, h, [&](const TexGraph::Tile& t) {
+                for(uint32_t x = t.row; x < t.row + t.rows; ++x) {
+                    const float* above = src + (size_t)((x != 0) ? (x - 1) : (h - 1)) * w;
+                    const float* centre = src + (size_t)x * w;
+                    const float* below = src + (size_t)((x + 1) % h) * w;
+
+                    for(uint32_t y = t.column; y < t.column + t.columns; ++y) {
+                        const uint32_t yp1 = (y + 1 == w) ? 0 : y + 1;
+                        const uint32_t ym1 = (y != 0) ? (y - 1) : (w - 1);
+
+                        const float c = centre[y];
+                        const float z0 = centre[yp1] - c;
+                        const float z1 = above[yp1]  - c;
+                        const float z2 = above[y]    - c;
+                        const float z3 = above[ym1]  - c;
+                        const float z4 = centre[ym1] - c;
+                        const float z5 = below[ym1]  - c;
+                        const float z6 = below[y]    - c;
+                        const float z7 = below[yp1]  - c;
+
+                        float sx = 0.0f - z0;
+                        sx += z2 - z1;
+                        sx += z3 - z2;
+                        sx += z4;
+                        sx += z4;
+                        sx += z5 - z6;
+                        sx += z6 - z7;
+                        sx -= z0;
+
+                        float sy = z0 - z1;
+                        sy -= z2;
+                        sy -= z2;
+                        sy += z4 - z3;
+                        sy += z5 - z4;
+                        sy += z6;
+                        sy += z6;
+                        sy += z7 - z0;
+
+                        const float sz = 8.0f;
+                        const float inv = 1.0f / std::sqrt((sx * sx + sy * sy) + sz * sz);
+
+                        float* o = dst + ((size_t)x * w + y) * 3;
+                        o[0] = sx * inv;
+                        o[1] = sy * inv;
+                        o[2] = sz * inv;
+                    }
+                }
+            });
+        }
+    };
+
+    class Pack : public TexGraph::Node {
+        TexGraph::Encoding encoding;
+
+    public:
+        Pack(TexGraph::NodePtr in, TexGraph::Encoding encoding) : Node("pack", {in}), encoding(encoding) {
+            mix(encoding);
+        }
+        uint32_t channels() const { return 4; }
+        TexGraph::Type type() const { return TexGraph::UINT8; }
+
+        inline uint8_t encode(float v) const {
+            if(encoding == TexGraph::SIGNED)
+                return ((std::min(std::max(v, -1.0f), 1.0f) + 1.0f) / 2.0f) * 255.0f;
+            return std::min(std::max(v, 0.0f), 1.0f) * 255.0f + 0.5f;
+        }
+
+        void run(const std::vector<const TexGraph::Image*>& in, TexGraph::Image& out) const {
+            const float* src = in[0]->floats();
+            const uint32_t c = in[0]->channels;
+            uint8_t* dst = out.uints();
+
+            TexGraph::forEachTile(out.width, out.height, [&](const TexGraph::Tile& t) {
+                for(uint32_t x = t.row; x < t.row + t.rows; ++x) {
+                    for(uint32_t y = t.column; y < t.column + t.columns; ++y) {
+                        const size_t i = (size_t)x * out.width + y;
+                        const float* s = src + i * c;
+                        uint8_t* o = dst + i * 4;
+                        o[0] = encode(s[0]);
+                        o[1] = (c == 1) ? o[0] : encode(s[1]);
+                        o[2] = (c == 1) ? o[0] : encode(s[2]);
+                        o[3] = (c == 4) ? encode(s[3]) : 0xff;
+                    }
+                }
+            });
+        }
+    };
+}
+
+struct TexGraph::BufferPool::State {
+    std::mutex lock;
+    /// Released buffers by size, these are the unaligned pointers from new[]
+    std::multimap<size_t, uint8_t*> free;
+    size_t allocations;
+    size_t reuses;
+
+    State() : allocations(0), reuses(0) {}
+    ~State() {
+        for(auto&& i : free) delete[] i.second;
+    }
+};
+
+TexGraph::BufferPool::BufferPool() : state(std::make_shared<State>()) {}
+
+TexGraph::BufferPool& TexGraph::BufferPool::global() {
+    static BufferPool pool;
+    return pool;
+}
+
+std::shared_ptr<uint8_t> TexGraph::BufferPool::acquire(size_t bytes) {
+    uint8_t* raw = nullptr;
+    {
+        std::lock_guard<std::mutex> guard(state->lock);
+        auto found = state->free.find(bytes);
+        if(found != state->free.end()) {
+            raw = found->second;
+            state->free.erase(found);
+            ++state->reuses;
+        }
+        else ++state->allocations;
+    }
+    if(raw == nullptr) raw = new uint8_t[bytes + ALIGNMENT - 1];
+
+    // The state outlives the pool if buffers are still out when it goes
+    std::shared_ptr<State> owner = state;
+    return std::shared_ptr<uint8_t>(align(raw), [owner, raw, bytes](uint8_t*) {
+        std::lock_guard<std::mutex> guard(owner->lock);
+        owner->free.insert(std::make_pair(bytes, raw));
+    });
+}
+
+void TexGraph::BufferPool::trim() {
+    std::lock_guard<std::mutex> guard(state->lock);
+    for(auto&& i : state->free) delete[] i.second;
+    state->free.clear();
+}
+
+size_t TexGraph::BufferPool::allocations() const {
+    std::lock_guard<std::mutex> guard(state->lock);
+    return state->allocations;
+}
+
+size_t TexGraph::BufferPool::reuses() const {
+    std::lock_guard<std::mutex> guard(state->lock);
+    return state->reuses;
+}
+
+void TexGraph::forEachTile(uint32_t w, uint32_t h, const std::function<void(const Tile&)>& fn) {
+    const uint32_t columns = (w + TILE_SIZE - 1) / TILE_SIZE;
+    const uint32_t rows = (h + TILE_SIZE - 1) / TILE_SIZE;
+
+    ThreadPool::global().parallelFor(0, (size_t)columns * rows, [&](size_t i) {
+        Tile t;
+        t.row = (i / columns) * TILE_SIZE;
+        t.column = (i % columns) * TILE_SIZE;
+        t.rows = std::min(TILE_SIZE, h - t.row);
+        t.columns = std::min(TILE_SIZE, w - t.column);
+        fn(t);
+    });
+}
+
+TexGraph::Node::Node(const char* name, std::vector<NodePtr> inputs) :
+    m_inputs(std::move(inputs)), m_key(14695981039346656037ULL) {
+    mix(name, std::strlen(name));
+    for(auto&& i : m_inputs) mix(i->key());
+}
+
+void TexGraph::Node::mix(const void* data, size_t size) {
+    // FNV-1a
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for(size_t x = 0; x < size; ++x) {
+        m_key ^= bytes[x];
+        m_key *= 1099511628211ULL;
+    }
+}
+
+TexGraph::NodePtr TexGraph::noise() {
+    return std::make_shared<Noise>();
+}
+
+TexGraph::NodePtr TexGraph::combine(NodePtr a, NodePtr b, float weight_a, float weight_b) {
+    if(!a || !b || a->type() != FLOAT || b->type() != FLOAT || a->channels() != b->channels())
+        throw std::invalid_argument("TexGraph::combine needs two float inputs with the same channels.");
+    return std::make_shared<Combine>(a, b, weight_a, weight_b);
+}
+
+TexGraph::NodePtr TexGraph::remap(NodePtr in, float low, float high, uint32_t levels) {
+    if(!in || in->type() != FLOAT || in->channels() != 1)
+        throw std::invalid_argument("TexGraph::remap needs a single channel float input.");
+    return std::make_shared<Remap>(in, low, high, levels);
+}
+
+TexGraph::NodePtr TexGraph::deriveNormal(NodePtr heights) {
+    if(!heights || heights->type() != FLOAT || heights->channels() != 1)
+        throw std::invalid_argument("TexGraph::deriveNormal needs a single channel float input.");
+    return std::make_shared<DeriveNormal>(heights);
+}
+
+TexGraph::NodePtr TexGraph::pack(NodePtr in, Encoding encoding) {
+    if(!in || in->type() != FLOAT || (in->channels() != 1 && in->channels() != 3 && in->channels() != 4))
+        throw std::invalid_argument("TexGraph::pack needs a float input with 1, 3 or 4 channels.");
+    return std::make_shared<Pack>(in, encoding);
+}
+
+TexGraph::Graph& TexGraph::Graph::shared() {
+    static Graph graph;
+    return graph;
+}
+
+std::shared_ptr<const TexGraph::Image> TexGraph::Graph::evaluate(const NodePtr& node, uint32_t w, uint32_t h) {
+    if(!node || w == 0 || h == 0) throw std::invalid_argument("TexGraph::Graph cannot evaluate an empty image.");
+
+    const auto id = std::make_pair(node->key(), ((uint64_t)w << 32) | h);
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        auto found = memo.find(id);
+        if(found != memo.end()) return found->second;
+    }
+
+    // Every input uses all the cores through its tiles, so one at a time is enough
+    std::vector< std::shared_ptr<const Image> > held;
+    std::vector<const Image*> in;
+    for(auto&& i : node->inputs()) {
+        held.push_back(evaluate(i, w, h));
+        in.push_back(held.back().get());
+    }
+
+    auto out = std::make_shared<Image>();
+    out->width = w;
+    out->height = h;
+    out->channels = node->channels();
+    out->type = node->type();
+    out->data = BufferPool::global().acquire(out->bytes());
+    node->run(in, *out);
+
+    // Another thread may have got here first, keep theirs so there is only one copy
+    std::lock_guard<std::mutex> guard(lock);
+    return memo.insert(std::make_pair(id, out)).first->second;
+}
+
+void TexGraph::Graph::clear() {
+    std::lock_guard<std::mutex> guard(lock);
+    memo.clear();
+}
+
+size_t TexGraph::Graph::size() {
+    std::lock_guard<std::mutex> guard(lock);
+    return memo.size();
+}
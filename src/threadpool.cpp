@@ -0,0 +1,255 @@
+#include "threadpool.h"
+
+#include <algorithm>
+
+thread_local ThreadPool* ThreadPool::current_pool = nullptr;
+thread_local unsigned ThreadPool::current_index = 0;
+
+namespace {
+    std::once_flag global_started;
+    std::unique_ptr<ThreadPool> global_pool;
+
+    int64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+}
+
+void JobCounter::add() {
+    std::lock_guard<std::mutex> guard(lock);
+    ++pending;
+}
+
+void JobCounter::done() {
+    std::vector< std::function<void()> > ready;
+    {
+        // Nothing touches the counter after this, whoever waits may destroy it
+        std::lock_guard<std::mutex> guard(lock);
+        if(--pending != 0) return;
+        ready.swap(continuations);
+        zero.notify_all();
+    }
+    for(auto&& i : ready) i();
+}
+
+void JobCounter::fail(std::exception_ptr e) {
+    std::lock_guard<std::mutex> guard(lock);
+    if(!error) error = e;
+}
+
+void JobCounter::finish(const std::function<void()>& job) {
+    // Thrown on a worker it would end the program, and skipping done() would hang whoever waits
+    try {
+        job();
+    } catch(...) {
+        fail(std::current_exception());
+    }
+    done();
+}
+
+bool JobCounter::finished() const {
+    std::lock_guard<std::mutex> guard(lock);
+    return pending == 0;
+}
+
+ThreadPool::ThreadPool(unsigned threads) : queued(0), stopping(false), stats_begin(nowNs()) {
+    if(threads == 0) threads = 1;
+    for(unsigned x = 0; x < threads; ++x)
+        queues.push_back(std::unique_ptr<Worker>(new Worker()));
+    for(unsigned x = 0; x < threads; ++x)
+        workers.push_back(std::thread(&ThreadPool::work, this, x));
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> guard(sleep_lock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for(auto&& i : workers) i.join();
+}
+
+void ThreadPool::start(unsigned threads) {
+    std::call_once(global_started, [threads]() { global_pool.reset(new ThreadPool(threads)); });
+}
+
+ThreadPool& ThreadPool::global() {
+    start();
+    return *global_pool;
+}
+
+void ThreadPool::work(unsigned index) {
+    current_pool = this;
+    current_index = index;
+    Worker& self = *queues[index];
+
+    for(;;) {
+        Job job;
+        if(take(job)) {
+            const int64_t began = nowNs();
+            job();
+            self.busy_ns += nowNs() - began;
+            ++self.jobs_run;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> guard(sleep_lock);
+        wake.wait(guard, [this]() { return stopping || queued > 0; });
+        if(stopping && queued == 0) return;
+    }
+}
+
+void ThreadPool::push(Job job) {
+    // Counted first, so a worker never sleeps while the job is on its way
+    ++queued;
+    if(current_pool == this) {
+        Worker& self = *queues[current_index];
+        std::lock_guard<std::mutex> guard(self.lock);
+        self.jobs.push_back(std::move(job));
+    } else {
+        std::lock_guard<std::mutex> guard(injected_lock);
+        injected.push_back(std::move(job));
+    }
+    // Taking the lock orders this against a worker about to sleep
+    { std::lock_guard<std::mutex> guard(sleep_lock); }
+    wake.notify_one();
+}
+
+bool ThreadPool::take(Job& job) {
+    const bool worker = current_pool == this;
+    if(worker) {
+        Worker& self = *queues[current_index];
+        std::lock_guard<std::mutex> guard(self.lock);
+        if(!self.jobs.empty()) {
+            job = std::move(self.jobs.back());
+            self.jobs.pop_back();
+            --queued;
+            return true;
+        }
+    }
+    {
+        std::lock_guard<std::mutex> guard(injected_lock);
+        if(!injected.empty()) {
+            job = std::move(injected.front());
+            injected.pop_front();
+            --queued;
+            return true;
+        }
+    }
+
+    // Steal the oldest job of the next worker that has one
+    const unsigned first = worker ? current_index + 1 : 0;
+    for(unsigned x = 0; x < queues.size(); ++x) {
+        const unsigned victim = (first + x) % queues.size();
+        if(worker && victim == current_index) continue;
+        Worker& other = *queues[victim];
+        std::lock_guard<std::mutex> guard(other.lock);
+        if(other.jobs.empty()) continue;
+        job = std::move(other.jobs.front());
+        other.jobs.pop_front();
+        --queued;
+        if(worker) ++queues[current_index]->steals;
+        return true;
+    }
+    return false;
+}
+
+bool ThreadPool::runOne() {
+    Job job;
+    if(!take(job)) return false;
+    job();
+    return true;
+}
+
+void ThreadPool::run(Job job, JobCounter* counter) {
+    if(counter == nullptr) {
+        push(std::move(job));
+        return;
+    }
+    counter->add();
+    push([job, counter]() { counter->finish(job); });
+}
+
+void ThreadPool::after(JobCounter& dependency, Job job, JobCounter* counter) {
+    if(counter != nullptr) counter->add();
+    auto queue = [this, job, counter]() {
+        run([job, counter]() {
+            if(counter != nullptr) counter->finish(job);
+            else job();
+        });
+    };
+
+    {
+        std::lock_guard<std::mutex> guard(dependency.lock);
+        if(dependency.pending != 0) {
+            dependency.continuations.push_back(queue);
+            return;
+        }
+    }
+    queue();
+}
+
+void ThreadPool::wait(JobCounter& counter) {
+    for(;;) {
+        if(counter.finished()) break;
+        if(runOne()) continue;
+
+        // Nothing to help with, sleep until the counter is done or more work may have turned up
+        std::unique_lock<std::mutex> guard(counter.lock);
+        counter.zero.wait_for(guard, std::chrono::milliseconds(1), [&counter]() { return counter.pending == 0; });
+    }
+
+    std::exception_ptr error;
+    {
+        std::lock_guard<std::mutex> guard(counter.lock);
+        error.swap(counter.error);
+    }
+    if(error) std::rethrow_exception(error);
+}
+
+void ThreadPool::parallelFor(size_t begin, size_t end, const std::function<void(size_t)>& fn) {
+    if(begin >= end) return;
+
+    // Claims indices until they run out, everything lives until wait() returns
+    std::atomic<size_t> next(begin);
+    auto claim = [&next, end, &fn]() {
+        try {
+            for(size_t i; (i = next++) < end;) fn(i);
+        } catch(...) {
+            // No point starting the rest
+            next = end;
+            throw;
+        }
+    };
+
+    JobCounter counter;
+    const size_t helpers = std::min<size_t>(workers.size(), end - begin - 1);
+    for(size_t x = 0; x < helpers; ++x) run(claim, &counter);
+
+    counter.add();
+    counter.finish(claim);
+    // The helpers still use next and fn, so this waits for them before rethrowing
+    wait(counter);
+}
+
+ThreadPool::Stats ThreadPool::stats() const {
+    Stats s;
+    s.elapsed_ms = (nowNs() - stats_begin) / 1e6;
+    for(auto&& i : queues) {
+        WorkerStats w;
+        w.jobs = i->jobs_run;
+        w.steals = i->steals;
+        w.busy_ms = i->busy_ns / 1e6;
+        s.workers.push_back(w);
+    }
+    return s;
+}
+
+void ThreadPool::resetStats() {
+    for(auto&& i : queues) {
+        i->jobs_run = 0;
+        i->steals = 0;
+        i->busy_ns = 0;
+    }
+    stats_begin = nowNs();
+}
@@ -1,38 +1,41 @@
-#include <QJsonArray>
-#include <QJsonValue>
 #include "shapes.h"
 #include "procedural.h"
+#include "texgraph.h"
+#include "texcache.h"
+#include "proceduralgpu.h"
 
-Track::Track(QJsonObject a) : normal_map_id(0) {
-    if(!a.contains("leftCurb") || !a.contains("rightCurb"))
-        throw std::invalid_argument("Track did not recieve a QJsonObject with left and right curb.");
-    if(!a["leftCurb"].isArray() || !a["rightCurb"].isArray())
-        throw std::invalid_argument("Track did not recieve a QJsonObject with curb arrays.");
-    QJsonArray lcurb = a["leftCurb"].toArray();
-    QJsonArray rcurb = a["rightCurb"].toArray();
-
-    for(auto&& i : lcurb) {
-        if(!i.isDouble()) throw std::invalid_argument("Track found invalid data within left curb.");
-        left_curb.push_back((GLfloat)i.toDouble());
-    }
-    for(auto&& i : rcurb) {
-        if(!i.isDouble()) throw std::invalid_argument("Track found invalid data within right curb.");
-        right_curb.push_back((GLfloat)i.toDouble());
-    }
+Track::Track(const GLfloat* left, size_t left_count, const GLfloat* right, size_t right_count,
+             bool gpu_textures, bool verify_textures) :
+    left_curb(left, left + left_count), right_curb(right, right + right_count), normal_map_id(0),
+    gpu_textures(gpu_textures), verify_textures(verify_textures) {}
+
+Track::~Track() {
+    if(normal_map_id == 0) return;
+    QOpenGLContext *ctx = QOpenGLContext::currentContext();
+    if(ctx == nullptr) return;
+
+    QOpenGLFunctions_4_1_Core* gl = ctx->versionFunctions<QOpenGLFunctions_4_1_Core>();
+
+    if(gl == nullptr) return;
+    gl->glDeleteTextures(1, &normal_map_id);
+    normal_map_id = 0;
 }
 
-void Track::init() {
+namespace {
+    const uint32_t NORMAL_MAP_SIZE = 512;
+}
+
+MeshData Track::build() const {
     const glm::vec3 up(0.0f, 1.0f, 0.0f);
 
     // how many times it repeats the normal map for a 1x1 world coordinate box
     const float repeate_rate = 0.25f;
 
-    if(m_vao != 0) return;
-
-    std::vector<GLfloat> points;
-    std::vector<GLfloat> normals;
-    std::vector<GLuint> elements;
-    std::vector<GLfloat> uvcoords;
+    MeshData data;
+    std::vector<GLfloat>& points = data.positions;
+    std::vector<GLfloat>& normals = data.normals;
+    std::vector<GLfloat>& uvcoords = data.texcoords;
+    std::vector<GLuint>& elements = data.indices;
 
     // Just in case the data is not as we expect
     unsigned int max = std::min(left_curb.size(), right_curb.size()) / 3;
@@ -59,24 +62,79 @@ void Track::init() {
         PUSH_BACK3(elements, x, x + 1, n + 1);  // left:  0 -- 2 -- 4
         PUSH_BACK3(elements, n + 1, n, x);      // right: 1 -- 3 -- 5
     }
+    return data;
+}
 
-    TriangleMesh::init(&elements, &points, &normals, nullptr, &uvcoords);
+void Track::prepare() {
+    TriangleMesh::prepare();
 
+    // The GPU path needs a context, it runs in init()
+    if(!gpu_textures && normal_map.levels.empty()) buildNormalMap();
+}
 
-    //Generate normal map
-    const uint32_t size = 512;
-    GLubyte* height_map = Procedural::generateHeightMap(size, size);
-    GLubyte* normal_map = Procedural::generateNormalMap(size, size, height_map); //Procedural::heightMapToRGBA(size, size, height_map);
-    delete[] height_map;
+void Track::buildNormalMap() {
+    const uint32_t size = NORMAL_MAP_SIZE;
+
+    // Generate the normal map, unless it is already in the cache from a previous run
+    const std::string cache_file = "cache/track_normal.tex";
+    const uint64_t key = TextureCache::makeKey("track_normal", Procedural::VERSION, size, size);
+
+    if(!TextureCache::load(cache_file, key, normal_map)) {
+        // The same texels as Procedural::generateNormalMap(generateHeightMap())
+        TexGraph::NodePtr heights = TexGraph::remap(TexGraph::noise(), 0.0f, 1.0f, 256);
+        TexGraph::NodePtr normals = TexGraph::pack(TexGraph::deriveNormal(heights), TexGraph::SIGNED);
+        std::shared_ptr<const TexGraph::Image> base = TexGraph::Graph::shared().evaluate(normals, size, size);
+
+        normal_map.width = normal_map.height = size;
+        normal_map.block_bytes = 4;
+        normal_map.internal_format = GL_RGBA8;
+        normal_map.format = GL_RGBA;
+        normal_map.levels.push_back(std::vector<uint8_t>(base->uints(), base->uints() + base->bytes()));
+
+        TextureCache::buildMipChain(normal_map, Procedural::downsampleNormalMap);
+        // Only x and y are stored, the shader reconstructs z
+        TextureCache::encode(normal_map, GL_COMPRESSED_RG_RGTC2, 0, 4, 16, Procedural::compressNormalMapRGTC);
+        if(!TextureCache::save(cache_file, key, normal_map))
+            qWarning("Unable to write texture cache %s", cache_file.c_str());
+    }
+}
+
+void Track::init() {
+    if(m_vao != 0) return;
+    prepare();
+    TriangleMesh::init();
 
     QOpenGLFunctions_4_1_Core* gl =
   		QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_4_1_Core>();
+    const uint32_t size = NORMAL_MAP_SIZE;
+
+    if(gpu_textures) {
+        try {
+            ProceduralGPU generator;
+            GLuint height_map = generator.generateHeightMap(size, size);
+            try {
+                normal_map_id = generator.generateNormalMap(size, size, height_map);
+            } catch(...) {
+                gl->glDeleteTextures(1, &height_map);
+                throw;
+            }
+            gl->glDeleteTextures(1, &height_map);
+
+            if(verify_textures && !generator.verify(size, size))
+                qWarning("GPU normal map does not match the CPU one");
+            return;
+        } catch(ShaderException &e) {
+            qWarning("Falling back to CPU textures: %s \n%s", e.what(), e.getOpenGLLog().c_str());
+        } catch(std::runtime_error &e) {
+            qWarning("Falling back to CPU textures: %s", e.what());
+        }
+        buildNormalMap();
+    }
 
     gl->glActiveTexture(GL_TEXTURE0);
     gl->glGenTextures(1, &normal_map_id);
 
     gl->glBindTexture(GL_TEXTURE_2D, normal_map_id);
-    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    gl->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, &normal_map[0]);
+    TextureCache::upload(gl, normal_map);
+    normal_map = TextureCache::Image();
 }
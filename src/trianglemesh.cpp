@@ -1,4 +1,5 @@
 #include "mesh.h"
+#include "meshopt.h"
 
 using std::vector;
 
@@ -16,6 +17,28 @@ void TriangleMesh::render() {
     gl->glBindVertexArray(0);
 }
 
+void TriangleMesh::prepare() {
+    std::call_once(m_prepared, [this]() {
+        m_pending = build();
+        m_pending.optimize();
+        setBounds(m_pending.positions.data(), m_pending.vertexCount());
+    });
+}
+
+void TriangleMesh::init() {
+    if(m_vao != 0) return;
+    prepare();
+    upload(m_pending);
+    m_pending = MeshData();
+}
+
+void TriangleMesh::upload(const MeshData& data) {
+    init(data.indices.data(), data.indices.size(), data.positions.data(), data.vertexCount(),
+         data.normals.empty()   ? nullptr : data.normals.data(),
+         data.colors.empty()    ? nullptr : data.colors.data(),
+         data.texcoords.empty() ? nullptr : data.texcoords.data());
+}
+
 void TriangleMesh::init(vector<GLuint>*  tris,        // The index data
                         vector<GLfloat>* points,      // The position data (must be non-NULL)
                         vector<GLfloat>* normals,     // The normal vector data (can be NULL)
@@ -24,8 +47,33 @@ void TriangleMesh::init(vector<GLuint>*  tris,        // The index data
     if( tris == NULL || points == NULL )
         qFatal("initGpuVertexArrays: the index data and position data must be non-NULL.");
 
+    // Reorder for the GPU before uploading, this changes the arrays in place
+    std::vector<MeshOpt::Stream> streams;
+    MeshOpt::Stream s = { points, 3 };
+    streams.push_back(s);
+    if( normals != NULL ) { s.data = normals; s.components = 3; streams.push_back(s); }
+    if( colors != NULL ) { s.data = colors; s.components = 4; streams.push_back(s); }
+    if( texCoords != NULL ) { s.data = texCoords; s.components = 2; streams.push_back(s); }
+    MeshOpt::optimize(*tris, streams);
+
+    init(tris->data(), tris->size(), points->data(), points->size() / 3,
+         normals   ? normals->data()   : nullptr,
+         colors    ? colors->data()    : nullptr,
+         texCoords ? texCoords->data() : nullptr);
+}
+
+void TriangleMesh::init(const GLuint*  tris,          // The index data
+                        GLuint         elements,      // The number of indices
+                        const GLfloat* points,        // The position data (must be non-NULL)
+                        GLuint         vertices,      // The number of vertices
+                        const GLfloat* normals,       // The normal vector data (can be NULL)
+                        const GLfloat* colors,        // The color data (can be NULL)
+                        const GLfloat* texCoords) {   // The texture coordinate data (can be NULL)
+    if( (tris == NULL && elements > 0) || (points == NULL && vertices > 0) )
+        qFatal("initGpuVertexArrays: the index data and position data must be non-NULL.");
+
     // Store the number of elements for later rendering.
-    m_elements = tris->size();
+    m_elements = elements;
 
     QOpenGLFunctions_4_1_Core* gl =
             QOpenGLContext::currentContext()->versionFunctions<QOpenGLFunctions_4_1_Core>();
@@ -48,32 +96,32 @@ void TriangleMesh::init(vector<GLuint>*  tris,        // The index data
     int bufIndex = 0;
     // Copy data into the index buffer
     gl->glBindBuffer(GL_ARRAY_BUFFER, m_buffers[bufIndex]);
-    gl->glBufferData(GL_ARRAY_BUFFER, tris->size() * sizeof(GLuint), &(*tris)[0], GL_STATIC_DRAW);
+    gl->glBufferData(GL_ARRAY_BUFFER, elements * sizeof(GLuint), tris, GL_STATIC_DRAW);
 
     // Copy data into the point buffer
     bufIndex++;
     gl->glBindBuffer(GL_ARRAY_BUFFER, m_buffers[bufIndex]);
-    gl->glBufferData(GL_ARRAY_BUFFER, points->size() * sizeof(GLfloat), &(*points)[0], GL_STATIC_DRAW);
+    gl->glBufferData(GL_ARRAY_BUFFER, vertices * 3 * sizeof(GLfloat), points, GL_STATIC_DRAW);
 
     if( normals != NULL ) {
         // Copy data into the normals buffer
         bufIndex++;
         gl->glBindBuffer(GL_ARRAY_BUFFER, m_buffers[bufIndex]);
-        gl->glBufferData(GL_ARRAY_BUFFER, normals->size() * sizeof(GLfloat), &(*normals)[0], GL_STATIC_DRAW);
+        gl->glBufferData(GL_ARRAY_BUFFER, vertices * 3 * sizeof(GLfloat), normals, GL_STATIC_DRAW);
     }
 
     if( colors != NULL ) {
         // Copy into the colors buffer
         bufIndex++;
         gl->glBindBuffer(GL_ARRAY_BUFFER, m_buffers[bufIndex]);
-        gl->glBufferData(GL_ARRAY_BUFFER, colors->size() * sizeof(GLfloat), &(*colors)[0], GL_STATIC_DRAW);
+        gl->glBufferData(GL_ARRAY_BUFFER, vertices * 4 * sizeof(GLfloat), colors, GL_STATIC_DRAW);
     }
 
     if( texCoords != NULL ) {
         // Copy into the tex coordinate buffer
         bufIndex++;
         gl->glBindBuffer(GL_ARRAY_BUFFER, m_buffers[bufIndex]);
-        gl->glBufferData(GL_ARRAY_BUFFER, texCoords->size() * sizeof(GLfloat), &(*texCoords)[0], GL_STATIC_DRAW);
+        gl->glBufferData(GL_ARRAY_BUFFER, vertices * 2 * sizeof(GLfloat), texCoords, GL_STATIC_DRAW);
     }
 
     // Create and set up the vertex array object (VAO).  The VAO contains
@@ -1,58 +1,60 @@
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QJsonArray>
-#include <QFile>
-
+#include <algorithm>
+#include <functional>
+#include <map>
 #include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
 
 #include "world.h"
+#include "objmesh.h"
+#include "scenefile.h"
+#include "texgraph.h"
+#include "threadpool.h"
 
-#define REF(t, x) ((float)t[x].toDouble())
-
-World::World(const std::string& file_name, Shader& s) : initlized(false), shader(s) {
-    mtl_ground = std::make_shared<Material>(
+World::World(const std::string& file_name, Shader& s) :
+        initlized(false), shader(s), scene_file(file_name) {
+    mtl_ground = arena.share<Material>(
         glm::vec3(0.0f),                    // Emmission
         glm::vec3(0.0f),                    // Ambient reflectivity
         glm::vec3(0.671f, 0.486f, 0.246f),  // Diffuse reflectivity
         glm::vec3(0.0f),                    // Specular reflectivity
         1.0f                                // Shine
     );
-    mtl_track = std::make_shared<Material>(
+    mtl_track = arena.share<Material>(
         glm::vec3(0.0f),
         glm::vec3(0.0f),
         glm::vec3(0.150f, 0.150f, 0.150f),
         glm::vec3(0.1f),
         40.0f
     );
-    mtl_tree = std::make_shared<Material>(
+    mtl_tree = arena.share<Material>(
         glm::vec3(0.0f),
         glm::vec3(0.0f),
         glm::vec3(0.031f, 0.565f, 0.067f),
         glm::vec3(0.0f),
         1.0f
     );
-    mtl_trunk = std::make_shared<Material>(
+    mtl_trunk = arena.share<Material>(
         glm::vec3(0.0f),
         glm::vec3(0.0f),
         glm::vec3(0.565f, 0.341f, 0.051f),
         glm::vec3(0.0f),
         1.0f
     );
-    mtl_building = std::make_shared<Material>(
+    mtl_building = arena.share<Material>(
         glm::vec3(0.0f),
         glm::vec3(0.0f),
         glm::vec3(0.898f, 0.898f, 0.898f),
         glm::vec3(0.0f),
         1.0f
     );
-    mtl_lamp = std::make_shared<Material>(
+    mtl_lamp = arena.share<Material>(
         glm::vec3(1.0f),
         glm::vec3(0.0f),
         glm::vec3(1.0f),
         glm::vec3(0.0f),
         1.0f
     );
-    mtl_post = std::make_shared<Material>(
+    mtl_post = arena.share<Material>(
         glm::vec3(0.0f),
         glm::vec3(0.0f),
         glm::vec3(0.671f, 0.671f, 0.671f),
@@ -60,167 +62,340 @@ World::World(const std::string& file_name, Shader& s) : initlized(false), shader
         80.0f
     );
 
-    race_track = ground = car = nullptr; //init to null
+    startup_begin = std::chrono::steady_clock::now();
+
+    // The model takes longest, so it loads while the rest is parsed
+    car = new Car(shader);
+    car_pivot = entities.createPivot(car->getMobTransform());
+    car_entities = entities.add(*car, car_pivot);
+    prepareAsync("obj", entities.meshesOf(car_entities));
+
+    // ~World will not run if the rest throws, and the model task still uses entities
+    try {
+        // Load race data, from the compiled scene unless the JSON has changed since
+        auto read_begin = std::chrono::steady_clock::now();
+        if(!readScene(scene)) qFatal("Unable to open %s", scene_file.c_str());
+        recordPhase("read", read_begin);
+
+        auto scene_begin = std::chrono::steady_clock::now();
+        applyGlobals();
+        ground = makeGround();
+        race_track = makeTrack();
+
+        for(size_t i = 0; i < scene.tree_heights.size(); ++i)
+            trees.push_back(makeTree(&scene.tree_positions[i * 3], scene.tree_heights[i]));
+        for(size_t i = 0; i < scene.building_heights.size() / 4; ++i)
+            buildings.push_back(makeBuilding(&scene.building_outlines[i * 12], &scene.building_heights[i * 4]));
+        for(size_t i = 0; i < scene.lamp_heights.size(); ++i)
+            lamps.push_back(makeLamp(&scene.lamp_positions[i * 3], scene.lamp_heights[i]));
+
+        {
+            glm::vec3 pyr = glm::make_vec3(scene.globals.start_pyr);
+            glm::vec3 pos = glm::make_vec3(scene.globals.start_position);
+            car->updateMobVals(&pyr, &pos);
+        }
+        recordPhase("scene", scene_begin);
 
-    // Load race data
-    QFile json_data(file_name.c_str());
-    if( !json_data.open(QIODevice::ReadOnly) ) {
-        qFatal("Unable to open %s", file_name.c_str());
+        // Track textures and the other shapes' geometry, alongside the model
+        prepareAsync("track", entities.meshesOf(race_track));
+        std::vector<EntityStore::Group> shapes;
+        shapes.insert(shapes.end(), trees.begin(), trees.end());
+        shapes.insert(shapes.end(), lamps.begin(), lamps.end());
+        shapes.insert(shapes.end(), buildings.begin(), buildings.end());
+        shapes.push_back(ground);
+        prepareAsync("shapes", shapes);
+    } catch(...) {
+        for(auto&& i : preparing) i.wait();
+        delete car;
+        throw;
     }
+}
+
+World::~World() {
+    // The tasks still record their phases
+    for(auto&& i : preparing) i.wait();
+    delete car;
+}
 
-    QJsonParseError err;
-    QJsonDocument jsonDoc = QJsonDocument::fromJson(json_data.readAll(), &err);
-    QJsonObject json = jsonDoc.object();
+void World::prepareAsync(const std::string& phase, const std::vector< std::shared_ptr<Mesh> >& shared) {
+    // Not owning, a worker may drop the task after ~World has waited for it and the arena is gone
+    std::vector<Mesh*> meshes;
+    for(auto&& i : shared) meshes.push_back(i.get());
+    preparing.push_back(ThreadPool::global().submit([this, phase, meshes]() {
+        auto began = std::chrono::steady_clock::now();
+        for(auto&& i : meshes) i->prepare();
+        recordPhase(phase, began);
+    }));
+}
 
-    QJsonArray adata = json["bbox"].toArray();
-    bbox[0] = glm::vec3(
-        REF(adata, 0),
-        REF(adata, 1),
-        REF(adata, 2)
-    );
-    bbox[1] = glm::vec3(
-        REF(adata, 3),
-        REF(adata, 4),
-        REF(adata, 5)
-    );
+void World::prepareAsync(const std::string& phase, const std::vector<EntityStore::Group>& groups) {
+    prepareAsync(phase, entities.meshesOf(groups));
+}
+
+void World::recordPhase(const std::string& phase, std::chrono::steady_clock::time_point began) {
+    std::chrono::duration<double, std::milli> took = std::chrono::steady_clock::now() - began;
+    std::lock_guard<std::mutex> guard(startup_lock);
+    startup_times.push_back(std::make_pair(phase, took.count()));
+}
+
+bool World::readScene(SceneFile::Scene& out) {
+    MappedFile compiled;
+    SceneFile::View view;
+    const std::string suffix = ".scene";
+    const bool precompiled = scene_file.size() > suffix.size() &&
+        scene_file.compare(scene_file.size() - suffix.size(), suffix.size(), suffix) == 0;
+
+    if(precompiled) {
+        if(!SceneFile::load(scene_file, compiled, view)) return false;
+    } else if(!SceneFile::load(SceneFile::pathFor(scene_file), compiled, view, scene_file)) {
+        if(!SceneFile::parseJson(scene_file, out)) return false;
+        if(!SceneFile::save(SceneFile::pathFor(scene_file), out.view(), scene_file))
+            qWarning("Unable to write %s", SceneFile::pathFor(scene_file).c_str());
+        return true;
+    }
+    out.assign(view);
+    return true;
+}
+
+void World::applyGlobals() {
+    const SceneFile::Globals& g = scene.globals;
+    bbox[0] = glm::make_vec3(g.bbox_min);
+    bbox[1] = glm::make_vec3(g.bbox_max);
     {
-        glm::vec3 points[4] = {
-            glm::vec3(bbox[1].x, bbox[0].y - 1e-3, bbox[0].z),
-            glm::vec3(bbox[1].x, bbox[0].y - 1e-3, bbox[1].z),
-            glm::vec3(bbox[0].x, bbox[0].y - 1e-3, bbox[1].z),
-            glm::vec3(bbox[0].x, bbox[0].y - 1e-3, bbox[0].z)
-        };
-        ground = new SceneEntity(
-            shader,
-            std::make_shared<Quad>(points),
-            nullptr,
-            mtl_ground
-        );
+        std::lock_guard<std::mutex> guard(globals_lock);
+        photo_pos = glm::make_vec3(g.photo_position);
+        observer_pos = glm::make_vec3(g.observer_position);
     }
+    sun_direction = glm::make_vec3(g.sun_direction);
+    sun_intensity = glm::make_vec3(g.sun_intensity);
+    lamp_intensity = glm::make_vec3(g.lamp_intensity);
 
-    race_track = new SceneEntity(
-        shader,std::make_shared<Track>(json["track"].toObject()),
-        nullptr, mtl_track, true
-    );
+    // Only the first MAX_LAMPS light the scene, the rest are still drawn
+    for(unsigned x = 0; x < MAX_LAMPS; ++x) {
+        if(x < scene.lamp_heights.size()) {
+            lamp_positions[x] = glm::vec3(
+                scene.lamp_positions[x * 3],
+                scene.lamp_heights[x] - 0.5f,
+                scene.lamp_positions[x * 3 + 2]
+            );
+        } else {
+            lamp_positions[x] = glm::vec3(0.0f);
+        }
+    }
+}
+
+glm::vec3 World::photoPosition() const {
+    std::lock_guard<std::mutex> guard(globals_lock);
+    return photo_pos;
+}
+
+glm::vec3 World::observerPosition() const {
+    std::lock_guard<std::mutex> guard(globals_lock);
+    return observer_pos;
+}
 
-    adata = json["trees"].toArray();
-    for(auto&& i : adata) {
-        QJsonObject t1 = i.toObject();
-        MultiEntity* tree = MeshMaker::tree(shader, REF(t1, "height"), mtl_trunk, mtl_tree);
-
-        QJsonArray t2 = t1["position"].toArray();
-        glm::vec3 pos(
-            REF(t2, 0),
-            REF(t2, 1),
-            REF(t2, 2)
-        );
-        tree->objtowld = glm::translate(glm::mat4(), pos) * tree->objtowld;
-        trees.push_back(tree);
+void World::setLightUniforms(glm::mat4 view) {
+    // Positional lights
+    for(unsigned int x = 0; x < MAX_LAMPS; ++x) {
+        glm::vec4 tmp = view * glm::vec4(lamp_positions[x], 1.0f);
+        std::string tmp2 = "lamps[" + std::to_string(x) + "]";
+        shader.setUniform(tmp2.c_str(), glm::vec3(tmp));
     }
+    shader.setUniform("lamp_intensity", lamp_intensity);
 
-    adata = json["buildings"].toArray();
-    for(auto&& i : adata) {
-        QJsonArray t = i.toObject()["outline"].toArray();
-        glm::vec3 points[4] = {
-            glm::vec3(REF(t, 0), REF(t, 1), REF(t, 2)),
-            glm::vec3(REF(t, 4), REF(t, 5), REF(t, 6)),
-            glm::vec3(REF(t, 8), REF(t, 9), REF(t, 10)),
-            glm::vec3(REF(t, 12), REF(t, 13), REF(t, 14))
-        };
-        float heights[4] = { REF(t, 3), REF(t, 7), REF(t, 11), REF(t, 15) };
-        buildings.push_back(
-            new SceneEntity(shader, std::make_shared<Building>(points, heights), nullptr, mtl_building)
-        );
+    // Directional lights
+    view[3] = glm::vec4(0, 0, 0, 1.0f); //remove translation
+    glm::vec4 tmp = (view * glm::vec4(sun_direction, 0));
+    shader.setUniform("sun_direction", glm::vec3(tmp));
+    shader.setUniform("sun_intensity", sun_intensity);
+}
+
+EntityStore::Group World::makeGround() {
+    glm::vec3 points[4] = {
+        glm::vec3(bbox[1].x, bbox[0].y - 1e-3, bbox[0].z),
+        glm::vec3(bbox[1].x, bbox[0].y - 1e-3, bbox[1].z),
+        glm::vec3(bbox[0].x, bbox[0].y - 1e-3, bbox[1].z),
+        glm::vec3(bbox[0].x, bbox[0].y - 1e-3, bbox[0].z)
+    };
+    return entities.add(SceneEntity(
+        shader,
+        shareIn<Quad>(propArena(), points),
+        nullptr,
+        mtl_ground
+    ));
+}
+
+EntityStore::Group World::makeTrack() {
+    const uint32_t flags = scene.globals.track_flags;
+    return entities.add(SceneEntity(
+        shader,
+        shareIn<Track>(propArena(),
+            scene.left_curb.data(), scene.left_curb.size(), scene.right_curb.data(), scene.right_curb.size(),
+            (flags & SceneFile::TRACK_GPU_TEXTURES) != 0,
+            (flags & SceneFile::TRACK_VERIFY_TEXTURES) != 0
+        ),
+        nullptr, mtl_track, true
+    ));
+}
+
+EntityStore::Group World::makeTree(const float* position, float height) {
+    std::unique_ptr<MultiEntity> tree(MeshMaker::tree(propArena(), shader, height, mtl_trunk, mtl_tree));
+    return entities.add(*tree, glm::translate(glm::mat4(), glm::make_vec3(position)));
+}
+
+EntityStore::Group World::makeBuilding(const float* outline, const float* heights) {
+    glm::vec3 points[4] = {
+        glm::make_vec3(outline),
+        glm::make_vec3(outline + 3),
+        glm::make_vec3(outline + 6),
+        glm::make_vec3(outline + 9)
+    };
+    float h[4];
+    std::copy(heights, heights + 4, h);
+    return entities.add(SceneEntity(shader, shareIn<Building>(propArena(), points, h), nullptr, mtl_building));
+}
+
+EntityStore::Group World::makeLamp(const float* position, float height) {
+    std::unique_ptr<MultiEntity> lamp(MeshMaker::lamp(propArena(), shader, 4, mtl_post, mtl_lamp));
+    glm::vec3 pos(position[0], height - 0.5f, position[2]);
+    return entities.add(*lamp, glm::translate(glm::mat4(), pos));
+}
+
+namespace {
+    /// One record per prop, its floats from a followed by its floats from b
+    std::vector< std::vector<float> > records(const std::vector<float>& a, size_t a_stride,
+                                              const std::vector<float>& b, size_t b_stride) {
+        std::vector< std::vector<float> > out(b.size() / b_stride);
+        for(size_t x = 0; x < out.size(); ++x) {
+            out[x].assign(a.begin() + x * a_stride, a.begin() + (x + 1) * a_stride);
+            out[x].insert(out[x].end(), b.begin() + x * b_stride, b.begin() + (x + 1) * b_stride);
+        }
+        return out;
     }
 
-    car = new Car(shader);
-    {
-        adata = json["startPYR"].toArray();
-        glm::vec3 pyr(
-            REF(adata, 0),
-            REF(adata, 1),
-            REF(adata, 2)
-        );
-        adata = json["startPosition"].toArray();
-        glm::vec3 pos(
-            REF(adata, 0),
-            REF(adata, 1),
-            REF(adata, 2)
-        );
-        car->updateMobVals(&pyr, &pos);
+    /**
+     * Lines entities up with the new records. An entity whose record is still
+     * there is kept as is, the others are made by make (added) or dropped
+     * (removed). Afterwards entities[x] belongs to now[x].
+     */
+    void matchEntities(std::vector<EntityStore::Group>& entities,
+                       const std::vector< std::vector<float> >& was,
+                       const std::vector< std::vector<float> >& now,
+                       const std::function<EntityStore::Group(size_t)>& make,
+                       std::vector<EntityStore::Group>& added, std::vector<EntityStore::Group>& removed) {
+        std::multimap<std::vector<float>, EntityStore::Group> kept;
+        for(size_t x = 0; x < entities.size() && x < was.size(); ++x)
+            kept.insert(std::make_pair(was[x], entities[x]));
+
+        entities.clear();
+        for(size_t x = 0; x < now.size(); ++x) {
+            auto found = kept.find(now[x]);
+            if(found != kept.end()) {
+                entities.push_back(found->second);
+                kept.erase(found);
+            } else {
+                entities.push_back(make(x));
+                added.push_back(entities.back());
+            }
+        }
+        for(auto&& i : kept) removed.push_back(i.second);
     }
+}
 
-    adata = json["photoPosition"].toArray();
-    photo_pos = glm::vec3(
-        REF(adata, 0),
-        REF(adata, 1),
-        REF(adata, 2)
-    );
+bool World::reload() {
+    if(!initlized) init();
+    auto began = std::chrono::steady_clock::now();
 
-    adata = json["observerPosition"].toArray();
-    observer_pos = glm::vec3(
-        REF(adata, 0),
-        REF(adata, 1),
-        REF(adata, 2)
-    );
+    SceneFile::Scene next;
+    try {
+        if(!readScene(next)) {
+            qWarning("Unable to read %s, keeping the loaded scene", scene_file.c_str());
+            return false;
+        }
+    } catch(std::invalid_argument& e) {
+        qWarning("%s: %s Keeping the loaded scene", scene_file.c_str(), e.what());
+        return false;
+    }
 
-    adata = json["weather"].toObject()["sunLightDirection"].toArray();
-    sun_direction = glm::vec3(
-        REF(adata, 0),
-        REF(adata, 1),
-        REF(adata, 2)
-    );
+    std::vector<EntityStore::Group> added, removed;
+    const SceneFile::Scene was = std::move(scene);
+    scene = std::move(next);
+    applyGlobals();
 
-    adata = json["lamps"].toArray();
-    unsigned int x = 0;
-    for(auto&& i : adata) {
-        QJsonObject t = i.toObject();
-        QJsonArray pos = t["position"].toArray();
-        lamp_positions[x] = glm::vec3(
-            REF(pos, 0),
-            REF(t, "height") - 0.5f,
-            REF(pos, 2)
-        );
-
-        MultiEntity* lamp = MeshMaker::lamp(shader, 4, mtl_post, mtl_lamp);
-        lamp->objtowld = glm::translate(glm::mat4(), lamp_positions[x++]) * lamp->objtowld;
-        lamps.push_back(lamp);
+    if(scene.left_curb != was.left_curb || scene.right_curb != was.right_curb ||
+       scene.globals.track_flags != was.globals.track_flags) {
+        removed.push_back(race_track);
+        race_track = makeTrack();
+        added.push_back(race_track);
+    }
+    if(!std::equal(was.globals.bbox_min, was.globals.bbox_min + 3, scene.globals.bbox_min) ||
+       !std::equal(was.globals.bbox_max, was.globals.bbox_max + 3, scene.globals.bbox_max)) {
+        removed.push_back(ground);
+        ground = makeGround();
+        added.push_back(ground);
     }
 
-    adata = json["lampIntensity"].toArray();
-    lamp_intensity = glm::vec3(
-        REF(adata, 0),
-        REF(adata, 1),
-        REF(adata, 2)
-    );
+    matchEntities(trees, records(was.tree_positions, 3, was.tree_heights, 1),
+                  records(scene.tree_positions, 3, scene.tree_heights, 1),
+                  [this](size_t x) { return makeTree(&scene.tree_positions[x * 3], scene.tree_heights[x]); },
+                  added, removed);
+    matchEntities(buildings, records(was.building_outlines, 12, was.building_heights, 4),
+                  records(scene.building_outlines, 12, scene.building_heights, 4),
+                  [this](size_t x) {
+                      return makeBuilding(&scene.building_outlines[x * 12], &scene.building_heights[x * 4]);
+                  },
+                  added, removed);
+    matchEntities(lamps, records(was.lamp_positions, 3, was.lamp_heights, 1),
+                  records(scene.lamp_positions, 3, scene.lamp_heights, 1),
+                  [this](size_t x) { return makeLamp(&scene.lamp_positions[x * 3], scene.lamp_heights[x]); },
+                  added, removed);
 
-    adata = json["weather"].toObject()["sunIntensity"].toArray();
-    sun_intensity = glm::vec3(
-        REF(adata, 0),
-        REF(adata, 1),
-        REF(adata, 2)
-    );
-}
+    // Only the new entities are built and uploaded, the context is current here
+    for(auto&& i : removed) entities.destroy(i);
+    std::vector< std::shared_ptr<Mesh> > meshes = entities.meshesOf(added);
+    ThreadPool::global().parallelFor(0, meshes.size(), [&meshes](size_t x) { meshes[x]->prepare(); });
+    entities.initMeshes();
+    entities.updateBounds();
 
-World::~World() {
-    delete race_track;
-    for(auto&& i : trees) delete i;
-    for(auto&& i : lamps) delete i;
-    for(auto&& i : buildings) delete i;
-    delete ground;
-    delete car;
+    std::chrono::duration<double, std::milli> took = std::chrono::steady_clock::now() - began;
+    printf("Reloaded %s in %.1f ms, %zu entities rebuilt, %zu removed\n",
+           scene_file.c_str(), took.count(), added.size(), removed.size());
+    return true;
 }
 
 void World::init() {
     if(initlized) return;
-    race_track->initMesh();
-    for(auto&& i : trees) i->initMesh();
-    for(auto&& i : lamps) i->initMesh();
-    for(auto&& i : buildings) i->initMesh();
-    ground->initMesh();
-    car->initMesh();
+
+    // get() passes on anything the tasks threw
+    auto wait_begin = std::chrono::steady_clock::now();
+    for(auto&& i : preparing) i.get();
+    preparing.clear();
+    recordPhase("wait", wait_begin);
+
+    auto upload_begin = std::chrono::steady_clock::now();
+    entities.initMeshes();
+    entities.updateBounds();
 
     shader.setUniform("normal_map", 0);
+    // Kept by the program, so once after it is linked rather than per draw
+    shader.setUniformBlock("Materials", ObjMesh::MATERIAL_BINDING);
+
+    // Everything generated has been uploaded, the intermediate images are no longer needed
+    TexGraph::Graph::shared().clear();
+    TexGraph::BufferPool::global().trim();
+    recordPhase("upload", upload_begin);
+    recordPhase("total", startup_begin);
+
+    printf("Startup:\n");
+    for(auto&& i : startup_times) printf("  %-8s %8.1f ms\n", i.first.c_str(), i.second);
+
+    const PoolBase::Counts multi = Pool<MultiEntity>::global().counts();
+    const PoolBase::Counts pools = PoolBase::totals();
+    printf("Allocations:\n");
+    printf("  arena    %8zu in %zu blocks, %.1f KiB\n", arena.allocations(), arena.blocksAllocated(),
+           arena.bytes() / 1024.0);
+    printf("  entities %8zu in %zu chunks, %zu reused\n", multi.allocations, multi.chunks, multi.reuses);
+    printf("  pools    %8zu in %zu chunks, %zu reused\n", pools.allocations, pools.chunks, pools.reuses);
 
     initlized = true;
 }